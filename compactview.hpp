@@ -0,0 +1,300 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "mesh.hpp"
+#include "utils/parallelbfs.hpp"
+
+
+namespace mesh
+{
+
+template <typename NodeDescription,
+          typename EdgeDescription = NodeDescription,
+          typename Storage = objects::types::HashStorage>
+class CompactView
+{
+public:
+    using NodePredicate = std::function<bool(const NodeDescription&)>;
+    using NodePredicateVec = std::vector<NodePredicate>;
+
+    static constexpr auto NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+    struct Range
+    {
+        const uint32_t* first = nullptr;
+        const uint32_t* last = nullptr;
+
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        std::size_t size() const { return static_cast<std::size_t>(last - first); }
+        bool empty() const { return first == last; }
+    };
+
+public:
+    explicit CompactView(const Mesh<NodeDescription, EdgeDescription, Storage>& mesh)
+        : m_ids{}
+        , m_values{}
+        , m_offsets{}
+        , m_neighbours{}
+        , m_edgeIds{}
+        , m_bfs{}
+    {
+        build(mesh);
+    }
+
+    std::size_t size() const { return m_ids.size(); }
+    bool empty() const { return m_ids.empty(); }
+
+    uint32_t index(uint32_t nodeId) const
+    {
+        const auto it = std::lower_bound(m_ids.cbegin(), m_ids.cend(), nodeId);
+        if (it == m_ids.cend() || *it != nodeId)
+        {
+            return NO_INDEX;
+        }
+        return static_cast<uint32_t>(it - m_ids.cbegin());
+    }
+
+    uint32_t id(uint32_t index) const { return m_ids[index]; }
+    const NodeDescription& value(uint32_t index) const { return m_values[index]; }
+
+    Range neighbours(uint32_t index) const
+    {
+        return {m_neighbours.data() + m_offsets[index], m_neighbours.data() + m_offsets[index + 1]};
+    }
+
+    Range edges(uint32_t index) const
+    {
+        return {m_edgeIds.data() + m_offsets[index], m_edgeIds.data() + m_offsets[index + 1]};
+    }
+
+    std::vector<uint32_t> pathBetween(uint32_t begin, uint32_t end) const
+    {
+        const auto beginIndex = index(begin);
+        const auto endIndex = index(end);
+        if (beginIndex == NO_INDEX || endIndex == NO_INDEX)
+        {
+            return {};
+        }
+        else if (beginIndex == endIndex)
+        {
+            return {begin};
+        }
+
+        auto parentBegin = std::vector<uint32_t>(m_ids.size(), NO_INDEX);
+        auto parentEnd = std::vector<uint32_t>(m_ids.size(), NO_INDEX);
+        auto frontierBegin = std::vector<uint32_t>{beginIndex};
+        auto frontierEnd = std::vector<uint32_t>{endIndex};
+        auto nextFrontier = std::vector<uint32_t>{};
+        parentBegin[beginIndex] = beginIndex;
+        parentEnd[endIndex] = endIndex;
+
+        while (!frontierBegin.empty() && !frontierEnd.empty())
+        {
+            const auto expandBegin = frontierBegin.size() <= frontierEnd.size();
+            auto& frontier = expandBegin ? frontierBegin : frontierEnd;
+            auto& parent = expandBegin ? parentBegin : parentEnd;
+            const auto& otherParent = expandBegin ? parentEnd : parentBegin;
+
+            nextFrontier.clear();
+            for (const auto nodeIndex : frontier)
+            {
+                for (const auto nextIndex : neighbours(nodeIndex))
+                {
+                    if (parent[nextIndex] != NO_INDEX)
+                    {
+                        continue;
+                    }
+                    parent[nextIndex] = nodeIndex;
+
+                    if (otherParent[nextIndex] != NO_INDEX)
+                    {
+                        return joinPath(nextIndex, parentBegin, parentEnd);
+                    }
+                    nextFrontier.push_back(nextIndex);
+                }
+            }
+            std::swap(frontier, nextFrontier);
+        }
+
+        return {};
+    }
+
+    bool isReachable(uint32_t begin, uint32_t end) const
+    {
+        const auto beginIndex = index(begin);
+        const auto endIndex = index(end);
+        if (beginIndex == NO_INDEX || endIndex == NO_INDEX)
+        {
+            return false;
+        }
+        return m_bfs.use([&](auto& bfs) { return bfs.reachable(Adjacency{*this}, beginIndex, endIndex); });
+    }
+
+    /** Component number of every view index, components are numbered from 1. */
+    std::vector<uint32_t> components() const
+    {
+        auto labels = std::vector<uint32_t>(m_ids.size(), 0);
+        m_bfs.use([&](auto& bfs)
+        {
+            return bfs.components(Adjacency{*this}, [&labels](uint32_t nodeIndex, uint32_t label) { labels[nodeIndex] = label; });
+        });
+        return labels;
+    }
+
+    uint32_t pathEnd(const NodePredicateVec& predicates) const
+    {
+        if (predicates.empty())
+        {
+            return 0;
+        }
+
+        auto frontier = std::vector<uint32_t>{};
+        for (auto i = 0u; i < m_ids.size(); ++i)
+        {
+            if (predicates[0](m_values[i]))
+            {
+                frontier.push_back(i);
+            }
+        }
+
+        auto inFrontier = std::vector<bool>(m_ids.size(), false);
+        auto nextFrontier = std::vector<uint32_t>{};
+        for (auto depth = 1u; depth < predicates.size() && !frontier.empty(); ++depth)
+        {
+            const auto& currentPredicate = predicates[depth];
+            nextFrontier.clear();
+            for (const auto nodeIndex : frontier)
+            {
+                for (const auto nextIndex : neighbours(nodeIndex))
+                {
+                    if (!inFrontier[nextIndex] && currentPredicate(m_values[nextIndex]))
+                    {
+                        inFrontier[nextIndex] = true;
+                        nextFrontier.push_back(nextIndex);
+                    }
+                }
+            }
+
+            for (const auto nodeIndex : nextFrontier)
+            {
+                inFrontier[nodeIndex] = false;
+            }
+            std::swap(frontier, nextFrontier);
+        }
+
+        return frontier.empty() ? 0 : m_ids[frontier.front()];
+    }
+
+private:
+    class Adjacency
+    {
+    public:
+        explicit Adjacency(const CompactView& view)
+            : m_view{view}
+        {}
+
+        uint32_t indexBound() const { return static_cast<uint32_t>(m_view.size()); }
+        uint32_t index(uint32_t nodeIndex) const { return nodeIndex; }
+        std::size_t degree(uint32_t nodeIndex) const { return m_view.neighbours(nodeIndex).size(); }
+        std::size_t arcCount() const { return m_view.m_neighbours.size(); }
+
+        template <typename Function>
+        bool forEachNeighbour(uint32_t nodeIndex, Function&& function) const
+        {
+            for (const auto nextIndex : m_view.neighbours(nodeIndex))
+            {
+                if (function(nextIndex))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        template <typename Function>
+        void forEachVertex(Function&& function) const
+        {
+            for (auto nodeIndex = 0u; nodeIndex < m_view.size(); ++nodeIndex)
+            {
+                function(nodeIndex);
+            }
+        }
+
+    private:
+        const CompactView& m_view;
+    };
+
+    void build(const Mesh<NodeDescription, EdgeDescription, Storage>& mesh)
+    {
+        m_ids.reserve(mesh.m_nodes.size());
+        for (const auto& nodeItem : mesh.m_nodes)
+        {
+            m_ids.push_back(nodeItem.first);
+        }
+        std::sort(m_ids.begin(), m_ids.end());
+
+        m_values.reserve(m_ids.size());
+        m_offsets.reserve(m_ids.size() + 1);
+        m_offsets.push_back(0);
+        for (const auto nodeId : m_ids)
+        {
+            const auto& node = mesh.m_nodes.find(nodeId)->second;
+            m_values.push_back(node.value());
+            m_offsets.push_back(m_offsets.back() + static_cast<uint32_t>(node.edges().size()));
+        }
+
+        m_neighbours.reserve(m_offsets.back());
+        m_edgeIds.reserve(m_offsets.back());
+        for (const auto nodeId : m_ids)
+        {
+            for (const auto edgeId : mesh.m_nodes.find(nodeId)->second.edges())
+            {
+                const auto& endpoints = mesh.m_edges.find(edgeId)->second.nodes();
+                const auto nextNodeId = endpoints.first == nodeId ? endpoints.second : endpoints.first;
+                m_neighbours.push_back(index(nextNodeId));
+                m_edgeIds.push_back(edgeId);
+            }
+        }
+    }
+
+    std::vector<uint32_t> joinPath(uint32_t commonIndex,
+                                   const std::vector<uint32_t>& parentBegin,
+                                   const std::vector<uint32_t>& parentEnd) const
+    {
+        auto result = std::vector<uint32_t>{};
+        for (auto nodeIndex = commonIndex; ; nodeIndex = parentBegin[nodeIndex])
+        {
+            result.push_back(m_ids[nodeIndex]);
+            if (parentBegin[nodeIndex] == nodeIndex)
+            {
+                break;
+            }
+        }
+        std::reverse(result.begin(), result.end());
+
+        for (auto nodeIndex = commonIndex; parentEnd[nodeIndex] != nodeIndex; )
+        {
+            nodeIndex = parentEnd[nodeIndex];
+            result.push_back(m_ids[nodeIndex]);
+        }
+        return result;
+    }
+
+private:
+    std::vector<uint32_t> m_ids;
+    std::vector<NodeDescription> m_values;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_neighbours;
+    std::vector<uint32_t> m_edgeIds;
+    utils::ParallelBfsCache m_bfs;
+};
+
+}  // namespace mesh
@@ -0,0 +1,315 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "utils/mappedfile.hpp"
+#include "utils/packformat.hpp"
+#include "utils/parallelbfs.hpp"
+
+
+namespace mesh
+{
+
+/**
+ * Read-only mesh served straight from a memory-mapped pack file (see
+ * MeshPack::to_file), nothing is copied on open and descriptions are views
+ * into the file. Opening checks the header only, call verify() before
+ * querying files which could be damaged or come from untrusted sources.
+ */
+class MappedView
+{
+public:
+    static constexpr auto NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+    struct Range
+    {
+        const uint32_t* first = nullptr;
+        const uint32_t* last = nullptr;
+
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        std::size_t size() const { return static_cast<std::size_t>(last - first); }
+        bool empty() const { return first == last; }
+    };
+
+public:
+    explicit MappedView(const std::filesystem::path& filename)
+        : m_file{filename}
+        , m_header{nullptr}
+        , m_nodes{nullptr}
+        , m_neighbours{nullptr}
+        , m_edgeIds{nullptr}
+        , m_edges{nullptr}
+        , m_strings{nullptr}
+        , m_bfs{}
+    {
+        if (m_file.size() < sizeof(utils::PackHeader))
+        {
+            throw std::invalid_argument{filename.string() + " is too small for a mesh pack"};
+        }
+
+        m_header = reinterpret_cast<const utils::PackHeader*>(m_file.data());
+        if (!m_header->valid())
+        {
+            throw std::invalid_argument{filename.string() + " is not a version 2 mesh pack"};
+        }
+
+        const auto layout = utils::PackLayout::of(*m_header, m_file.size());
+        if (!layout || layout->end != m_file.size())
+        {
+            throw std::invalid_argument{filename.string() + " size does not match its header"};
+        }
+
+        m_nodes = reinterpret_cast<const utils::PackNode*>(m_file.data() + layout->nodes);
+        m_neighbours = reinterpret_cast<const uint32_t*>(m_file.data() + layout->neighbours);
+        m_edgeIds = reinterpret_cast<const uint32_t*>(m_file.data() + layout->edgeIds);
+        m_edges = reinterpret_cast<const utils::PackEdge*>(m_file.data() + layout->edges);
+        m_strings = m_file.data() + layout->strings;
+    }
+
+    std::size_t size() const { return m_header->nodeCount; }
+    bool empty() const { return m_header->nodeCount == 0; }
+    std::size_t edgeCount() const { return m_header->edgeCount; }
+
+    uint32_t index(uint32_t nodeId) const
+    {
+        const auto last = m_nodes + size();
+        const auto it = std::lower_bound(m_nodes, last, nodeId,
+                                         [](const utils::PackNode& node, uint32_t id) { return node.id < id; });
+        if (it == last || it->id != nodeId)
+        {
+            return NO_INDEX;
+        }
+        return static_cast<uint32_t>(it - m_nodes);
+    }
+
+    uint32_t id(uint32_t index) const { return m_nodes[index].id; }
+
+    std::string_view value(uint32_t index) const
+    {
+        return {m_strings + m_nodes[index].descriptionOffset, m_nodes[index].descriptionSize};
+    }
+
+    Range neighbours(uint32_t index) const
+    {
+        return {m_neighbours + m_nodes[index].firstArc, m_neighbours + lastArc(index)};
+    }
+
+    Range edges(uint32_t index) const
+    {
+        return {m_edgeIds + m_nodes[index].firstArc, m_edgeIds + lastArc(index)};
+    }
+
+    uint32_t edgeIndex(uint32_t edgeId) const
+    {
+        const auto last = m_edges + edgeCount();
+        const auto it = std::lower_bound(m_edges, last, edgeId,
+                                         [](const utils::PackEdge& edge, uint32_t id) { return edge.id < id; });
+        if (it == last || it->id != edgeId)
+        {
+            return NO_INDEX;
+        }
+        return static_cast<uint32_t>(it - m_edges);
+    }
+
+    uint32_t edgeId(uint32_t edgeIndex) const { return m_edges[edgeIndex].id; }
+
+    /** Node IDs of edge endpoints. */
+    std::pair<uint32_t, uint32_t> endpoints(uint32_t edgeIndex) const
+    {
+        return {m_edges[edgeIndex].firstNodeId, m_edges[edgeIndex].secondNodeId};
+    }
+
+    std::string_view edgeValue(uint32_t edgeIndex) const
+    {
+        return {m_strings + m_edges[edgeIndex].descriptionOffset, m_edges[edgeIndex].descriptionSize};
+    }
+
+    std::vector<uint32_t> pathBetween(uint32_t begin, uint32_t end) const
+    {
+        const auto beginIndex = index(begin);
+        const auto endIndex = index(end);
+        if (beginIndex == NO_INDEX || endIndex == NO_INDEX)
+        {
+            return {};
+        }
+        else if (beginIndex == endIndex)
+        {
+            return {begin};
+        }
+
+        auto parent = std::vector<uint32_t>(size(), NO_INDEX);
+        auto frontier = std::vector<uint32_t>{beginIndex};
+        auto nextFrontier = std::vector<uint32_t>{};
+        parent[beginIndex] = beginIndex;
+
+        while (!frontier.empty())
+        {
+            nextFrontier.clear();
+            for (const auto nodeIndex : frontier)
+            {
+                for (const auto nextIndex : neighbours(nodeIndex))
+                {
+                    if (parent[nextIndex] != NO_INDEX)
+                    {
+                        continue;
+                    }
+                    parent[nextIndex] = nodeIndex;
+
+                    if (nextIndex == endIndex)
+                    {
+                        auto result = std::vector<uint32_t>{};
+                        for (auto pathIndex = endIndex; pathIndex != beginIndex; pathIndex = parent[pathIndex])
+                        {
+                            result.push_back(id(pathIndex));
+                        }
+                        result.push_back(begin);
+                        std::reverse(result.begin(), result.end());
+                        return result;
+                    }
+                    nextFrontier.push_back(nextIndex);
+                }
+            }
+            std::swap(frontier, nextFrontier);
+        }
+
+        return {};
+    }
+
+    bool isReachable(uint32_t begin, uint32_t end) const
+    {
+        const auto beginIndex = index(begin);
+        const auto endIndex = index(end);
+        if (beginIndex == NO_INDEX || endIndex == NO_INDEX)
+        {
+            return false;
+        }
+        return m_bfs.use([&](auto& bfs) { return bfs.reachable(Adjacency{*this}, beginIndex, endIndex); });
+    }
+
+    /** Component number of every view index, components are numbered from 1. */
+    std::vector<uint32_t> components() const
+    {
+        auto labels = std::vector<uint32_t>(size(), 0);
+        m_bfs.use([&](auto& bfs)
+        {
+            return bfs.components(Adjacency{*this}, [&labels](uint32_t nodeIndex, uint32_t label) { labels[nodeIndex] = label; });
+        });
+        return labels;
+    }
+
+    /**
+     * Compares the checksum and checks that every table entry points inside
+     * the file, reads the whole file.
+     */
+    bool verify() const
+    {
+        auto checksum = utils::PackChecksum{};
+        checksum.update(m_file.data() + sizeof(utils::PackHeader), m_file.size() - sizeof(utils::PackHeader));
+        if (checksum.value() != m_header->checksum)
+        {
+            return false;
+        }
+
+        const auto stringsSize = m_header->stringsSize;
+        const auto fits = [stringsSize](uint64_t offset, uint64_t size)
+        {
+            return offset <= stringsSize && size <= stringsSize - offset;
+        };
+
+        for (auto i = std::size_t{0}; i < size(); ++i)
+        {
+            const auto& node = m_nodes[i];
+            if ((i != 0 && m_nodes[i - 1].id >= node.id) ||
+                node.firstArc > lastArc(static_cast<uint32_t>(i)) ||
+                lastArc(static_cast<uint32_t>(i)) > m_header->arcCount ||
+                !fits(node.descriptionOffset, node.descriptionSize))
+            {
+                return false;
+            }
+        }
+
+        for (auto i = std::size_t{0}; i < m_header->arcCount; ++i)
+        {
+            if (m_neighbours[i] >= size())
+            {
+                return false;
+            }
+        }
+
+        for (auto i = std::size_t{0}; i < edgeCount(); ++i)
+        {
+            const auto& edge = m_edges[i];
+            if ((i != 0 && m_edges[i - 1].id >= edge.id) ||
+                !fits(edge.descriptionOffset, edge.descriptionSize))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    class Adjacency
+    {
+    public:
+        explicit Adjacency(const MappedView& view)
+            : m_view{view}
+        {}
+
+        uint32_t indexBound() const { return static_cast<uint32_t>(m_view.size()); }
+        uint32_t index(uint32_t nodeIndex) const { return nodeIndex; }
+        std::size_t degree(uint32_t nodeIndex) const { return m_view.neighbours(nodeIndex).size(); }
+        std::size_t arcCount() const { return m_view.m_header->arcCount; }
+
+        template <typename Function>
+        bool forEachNeighbour(uint32_t nodeIndex, Function&& function) const
+        {
+            for (const auto nextIndex : m_view.neighbours(nodeIndex))
+            {
+                if (function(nextIndex))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        template <typename Function>
+        void forEachVertex(Function&& function) const
+        {
+            for (auto nodeIndex = 0u; nodeIndex < m_view.size(); ++nodeIndex)
+            {
+                function(nodeIndex);
+            }
+        }
+
+    private:
+        const MappedView& m_view;
+    };
+
+    uint64_t lastArc(uint32_t index) const
+    {
+        return index + 1 < size() ? m_nodes[index + 1].firstArc : m_header->arcCount;
+    }
+
+private:
+    utils::MappedFile m_file;
+    const utils::PackHeader* m_header;
+    const utils::PackNode* m_nodes;
+    const uint32_t* m_neighbours;
+    const uint32_t* m_edgeIds;
+    const utils::PackEdge* m_edges;
+    const char* m_strings;
+    utils::ParallelBfsCache m_bfs;
+};
+
+}  // namespace mesh
@@ -3,101 +3,135 @@
  */
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include "objects/edge.hpp"
 #include "objects/imobject.hpp"
 #include "objects/node.hpp"
 #include "objects/types.hpp"
+#include "utils/changelog.hpp"
+#include "utils/dynamicconnectivity.hpp"
+#include "utils/execution.hpp"
+#include "utils/hopsearch.hpp"
+#include "utils/landmarks.hpp"
+#include "utils/parallelbfs.hpp"
+#include "utils/pathcache.hpp"
+#include "utils/pathsearch.hpp"
+#include "utils/traversal.hpp"
+#include "utils/valueindex.hpp"
 
 
 namespace mesh
 {
-template <typename NodeDescription, typename EdgeDescription>
+template <typename NodeDescription, typename EdgeDescription, typename Storage>
+class CompactView;
+
+template <typename NodeDescription, typename EdgeDescription, typename Storage>
 class MeshBuilder;
 
+template <typename NodeDescription, typename EdgeDescription, typename Storage>
+class PathQuery;
+
 namespace utils
 {
-template <typename NodeDescription, typename EdgeDescription>
+template <typename NodeDescription, typename EdgeDescription, typename Storage>
+class Journal;
+
+template <typename NodeDescription, typename EdgeDescription, typename Storage>
 class MeshPack;
 }  // namespace utils
 
-template <typename NodeDescription, typename EdgeDescription = NodeDescription>
+template <typename NodeDescription,
+          typename EdgeDescription = NodeDescription,
+          typename Storage = objects::types::HashStorage>
 struct Mesh
 {
-    friend class MeshBuilder<NodeDescription, EdgeDescription>;
-    friend class utils::MeshPack<NodeDescription, EdgeDescription>;
+    friend class CompactView<NodeDescription, EdgeDescription, Storage>;
+    friend class MeshBuilder<NodeDescription, EdgeDescription, Storage>;
+    friend class PathQuery<NodeDescription, EdgeDescription, Storage>;
+    friend class utils::Journal<NodeDescription, EdgeDescription, Storage>;
+    friend class utils::MeshPack<NodeDescription, EdgeDescription, Storage>;
 
     using U32PairMap = objects::types::U32PairMap;
-    using U32EdgeMap = objects::types::U32EdgeMap<EdgeDescription>;
-    using U32NodeMap = objects::types::U32NodeMap<NodeDescription>;
+    using U32EdgeMap = objects::types::U32EdgeMap<EdgeDescription, Storage>;
+    using U32NodeMap = objects::types::U32NodeMap<NodeDescription, Storage>;
     using U32Pair = objects::types::U32Pair;
     using U32PairPriorityQueue = objects::types::U32PairPriorityQueue;
     using U32Set = objects::types::U32Set;
+    using U32U32Map = objects::types::U32U32Map;
+    using U32Vector = objects::types::U32Vector;
+    using U64U32Map = objects::types::U64U32Map;
     using NodePredicate = std::function<bool(const NodeDescription&)>;
     using NodeVisitFunction = std::function<void(const NodeDescription&)>;
+    using Traversal = utils::Traversal<NodeDescription, EdgeDescription, Storage>;
     using EdgeVisitFunction = std::function<void(const EdgeDescription&)>;
 
 public:
-    explicit Mesh()
-        : m_nodes{}
-        , m_edges{}
+    explicit Mesh(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_resource{resource}
+        , m_nodes{resource}
+        , m_edges{resource}
+        , m_edgeIndex{resource}
+        , m_connectivity{}
+        , m_pathSearch{resource}
+        , m_hopSearch{resource}
+        , m_bfs{resource}
+        , m_landmarks{}
+        , m_valueIndex{}
+        , m_pathCache{}
+        , m_changeLog{nullptr}
+        , m_topologyVersion{0}
+        , m_descriptionVersion{0}
         , m_current{}
     {}
 
+    std::pmr::memory_resource* resource() const
+    {
+        return m_resource;
+    }
+
     void attach(NodeDescription nodeDescription = NodeDescription{},
                 EdgeDescription edgeDescription = EdgeDescription{})
     {
         if (m_current == 0)
         {
-            auto node = objects::Node{std::move(nodeDescription)};
-            auto nodeId = nodeIdGenerator();
-            m_current = nodeId;
-            m_nodes.insert({nodeId, std::move(node)});
+            m_current = insertNode(std::move(nodeDescription));
         }
         else
         {
-            auto node = objects::Node{std::move(nodeDescription)};
-            auto edge = objects::Edge{std::move(edgeDescription)};
-            auto nodeId = nodeIdGenerator();
-            auto edgeId = edgeIdGenerator();
+            auto nodeId = insertNode(std::move(nodeDescription));
+            auto edgeId = insertEdge({m_current, nodeId}, std::move(edgeDescription));
 
             m_nodes[m_current].edges().insert(edgeId);
-            node.edges().insert(edgeId);
-            edge.nodes().first = m_current;
-            edge.nodes().second = nodeId;
+            m_nodes[nodeId].edges().insert(edgeId);
 
             m_current = nodeId;
-
-            m_nodes.insert({nodeId, std::move(node)});
-            m_edges.insert({edgeId, std::move(edge)});
         }
+        endOperation();
     }
 
     void tie(uint32_t firstNodeId, uint32_t secondNodeId,
              EdgeDescription edgeDescription = EdgeDescription{})
     {
-        if (!contains(m_nodes, firstNodeId) ||
-            !contains(m_nodes, secondNodeId))
+        if (firstNodeId == secondNodeId ||
+            !contains(m_nodes, firstNodeId) ||
+            !contains(m_nodes, secondNodeId) ||
+            edgeBetween(firstNodeId, secondNodeId) != 0)
         {
             return;
         }
 
-        auto& leftNodeEdges = m_nodes[firstNodeId].edges();
-        auto& rightNodeEdges = m_nodes[secondNodeId].edges();
-        if (isIntersection(leftNodeEdges, rightNodeEdges))
-        {
-            return;
-        }
-
-        auto edge = objects::Edge{std::move(edgeDescription)};
-        auto edgeId = edgeIdGenerator();
-        edge.nodes().first = firstNodeId;
-        edge.nodes().second = secondNodeId;
-        leftNodeEdges.insert(edgeId);
-        rightNodeEdges.insert(edgeId);
-        m_edges.insert({edgeId, std::move(edge)});
+        auto edgeId = insertEdge({firstNodeId, secondNodeId}, std::move(edgeDescription));
+        m_nodes[firstNodeId].edges().insert(edgeId);
+        m_nodes[secondNodeId].edges().insert(edgeId);
+        endOperation();
     }
 
     void tie(uint32_t firstNodeId,
@@ -160,6 +194,27 @@ public:
         }
     }
 
+    /**
+     * Ties every node described by first with every node described by second.
+     * Not available for arithmetic descriptions, which would clash with node IDs.
+     */
+    template <typename Value = NodeDescription,
+              typename = std::enable_if_t<!std::is_arithmetic<Value>::value>>
+    void tie(const NodeDescription& first,
+             const NodeDescription& second,
+             EdgeDescription edgeDescription = EdgeDescription{})
+    {
+        const auto firstNodeIds = findAll(first);
+        const auto secondNodeIds = findAll(second);
+        for (const auto firstNodeId : firstNodeIds)
+        {
+            for (const auto secondNodeId : secondNodeIds)
+            {
+                tie(firstNodeId, secondNodeId, edgeDescription);
+            }
+        }
+    }
+
     void detach()
     {
         if (m_current != 0)
@@ -176,10 +231,10 @@ public:
             return;
         }
 
-        const auto itemEdgeIds = nodeItemIt->second.edges();
+        const auto itemEdgeIds = objects::types::U32SmallSet{nodeItemIt->second.edges(), m_resource};
         if (itemEdgeIds.empty())
         {
-            m_nodes.erase(id);
+            eraseNode(id);
         }
         else if (itemEdgeIds.size() == 1)
         {
@@ -189,32 +244,31 @@ public:
 
             m_nodes[nodeFirst].edges().erase(edgeId);
             m_nodes[nodeSecond].edges().erase(edgeId);
-            m_edges.erase(edgeId);
-            m_nodes.erase(id);
+            eraseEdge(edgeId);
+            eraseNode(id);
         }
         else
         {
-            auto relatedNodes = U32Set{};
+            auto relatedNodes = U32Set{m_resource};
             for (const auto edgeId : itemEdgeIds)
             {
                 auto nodeFirst = m_edges[edgeId].nodes().first;
                 auto nodeSecond = m_edges[edgeId].nodes().second;
+                auto relatedNode = (nodeFirst == id ? nodeSecond : nodeFirst);
 
-                m_nodes[nodeFirst].edges().erase(edgeId);
-                m_nodes[nodeSecond].edges().erase(edgeId);
-                m_edges.erase(edgeId);
-                m_nodes.erase(id);
-
-                if (nodeFirst == id)
-                {
-                    relatedNodes.insert(nodeSecond);
-                }
-                else
-                {
-                    relatedNodes.insert(nodeFirst);
-                }
+                m_nodes[relatedNode].edges().erase(edgeId);
+                eraseEdge(edgeId);
+                relatedNodes.insert(relatedNode);
+            }
+            eraseNode(id);
+            if (m_connectivity)
+            {
+                rebranchIndexed(std::move(relatedNodes));
+            }
+            else
+            {
+                rebranch(std::move(relatedNodes));
             }
-            rebranch(std::move(relatedNodes));
         }
 
         if (m_current == id)
@@ -225,13 +279,28 @@ public:
         {
             m_current = 0;
         }
+        endOperation();
     }
 
     void detach(std::vector<uint32_t> range)
     {
-        for (const auto& id : range)
+        auto doomedNodes = U32Set{m_resource};
+        for (const auto id : range)
         {
-            detach(id);
+            if (contains(m_nodes, id))
+            {
+                doomedNodes.insert(id);
+            }
+        }
+
+        if (doomedNodes.size() == 1)
+        {
+            detach(*doomedNodes.begin());
+        }
+        else if (!doomedNodes.empty())
+        {
+            detachBatch(std::move(doomedNodes));
+            endOperation();
         }
     }
 
@@ -261,38 +330,460 @@ public:
         }
     }
 
+    /**
+     * Every node at most hops away from nodeId as (node ID, distance) pairs,
+     * nodeId first, ordered by distance.
+     */
+    std::vector<U32Pair> neighbourhood(uint32_t nodeId, uint32_t hops)
+    {
+        auto reached = std::vector<U32Pair>{};
+        neighbourhood(nodeId, hops, reached);
+        return reached;
+    }
+
+    /** Same as above, but reuses capacity of given vector. */
+    void neighbourhood(uint32_t nodeId, uint32_t hops, std::vector<U32Pair>& reached)
+    {
+        reached.clear();
+        if (contains(m_nodes, nodeId))
+        {
+            const uint32_t seeds[] = {nodeId};
+            m_hopSearch.expand(Adjacency{*this}, seeds, hops, reached);
+        }
+    }
+
+    /** Nodes at most hops away from any of given nodes, with distance to the nearest one. */
+    std::vector<U32Pair> neighbourhood(const std::vector<uint32_t>& nodeIds, uint32_t hops)
+    {
+        auto reached = std::vector<U32Pair>{};
+        neighbourhood(nodeIds, hops, reached);
+        return reached;
+    }
+
+    void neighbourhood(const std::vector<uint32_t>& nodeIds, uint32_t hops, std::vector<U32Pair>& reached)
+    {
+        auto seeds = U32Vector{m_resource};
+        seeds.reserve(nodeIds.size());
+        for (const auto nodeId : nodeIds)
+        {
+            if (contains(m_nodes, nodeId))
+            {
+                seeds.push_back(nodeId);
+            }
+        }
+        m_hopSearch.expand(Adjacency{*this}, seeds, hops, reached);
+    }
+
+    /**
+     * New mesh made of copies of given nodes and of edges between them (the
+     * induced sub-mesh). idMapping receives new node ID of every copied node.
+     */
+    Mesh subMesh(const std::vector<uint32_t>& nodeIds, U32U32Map& idMapping) const
+    {
+        auto result = Mesh{m_resource};
+        idMapping.clear();
+        idMapping.reserve(nodeIds.size());
+        for (const auto nodeId : nodeIds)
+        {
+            const auto nodeIt = m_nodes.find(nodeId);
+            if (nodeIt != m_nodes.end() && !contains(idMapping, nodeId))
+            {
+                idMapping.emplace(nodeId, result.insertNode(nodeIt->second.value()));
+            }
+        }
+
+        for (const auto& mapped : idMapping)
+        {
+            for (const auto edgeId : m_nodes.find(mapped.first)->second.edges())
+            {
+                const auto& edge = m_edges.find(edgeId)->second;
+                const auto& endpoints = edge.nodes();
+                const auto secondIt = idMapping.find(endpoints.second);
+                if (endpoints.first == mapped.first && secondIt != idMapping.end())
+                {
+                    result.tie(mapped.second, secondIt->second, edge.value());
+                }
+            }
+        }
+        return result;
+    }
+
+    Mesh subMesh(const std::vector<uint32_t>& nodeIds) const
+    {
+        auto idMapping = U32U32Map{m_resource};
+        return subMesh(nodeIds, idMapping);
+    }
+
+    /** Lazily visits nodes reachable from nodeId level by level, nodeId first at depth 0. */
+    Traversal bfs(uint32_t nodeId) const
+    {
+        return Traversal{m_nodes, m_edges, nodeId, Traversal::Order::BREADTH_FIRST, m_resource};
+    }
+
+    /** Lazily visits nodes reachable from nodeId depth first, in preorder. */
+    Traversal dfs(uint32_t nodeId) const
+    {
+        return Traversal{m_nodes, m_edges, nodeId, Traversal::Order::DEPTH_FIRST, m_resource};
+    }
+
+    typename Traversal::Neighbours neighbours(uint32_t nodeId) const
+    {
+        return typename Traversal::Neighbours{m_nodes, m_edges, nodeId};
+    }
+
+    typename Traversal::Edges edgesOf(uint32_t nodeId) const
+    {
+        return typename Traversal::Edges{m_nodes, m_edges, nodeId};
+    }
+
+    /**
+     * Calls function(description) or function(id, description) for every
+     * node. Parallel policies split the node storage between threads.
+     */
+    template <typename Policy,
+              typename Function,
+              typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    void forEachNode(Policy policy, Function&& function) const
+    {
+        forEachItem(policy, m_nodes, function);
+    }
+
+    template <typename Function>
+    void forEachNode(Function&& function) const
+    {
+        forEachItem(execution::seq, m_nodes, function);
+    }
+
+    template <typename Policy,
+              typename Function,
+              typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    void forEachEdge(Policy policy, Function&& function) const
+    {
+        forEachItem(policy, m_edges, function);
+    }
+
+    template <typename Function>
+    void forEachEdge(Function&& function) const
+    {
+        forEachItem(execution::seq, m_edges, function);
+    }
+
+    /** Number of nodes for which predicate(description) or predicate(id, description) holds. */
+    template <typename Policy,
+              typename Predicate,
+              typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    std::size_t countIf(Policy policy, Predicate&& predicate) const
+    {
+        const auto slots = m_nodes.slotCount();
+        auto counts = std::vector<std::size_t>(utils::partCount(policy, slots), 0);
+        utils::forEachPart(counts.size(), slots, [&](std::size_t part, std::size_t first, std::size_t last)
+        {
+            auto count = std::size_t{0};
+            m_nodes.forEachInSlots(first, last, [&](uint32_t nodeId, const auto& node)
+            {
+                count += callWithValue(predicate, nodeId, node) ? 1 : 0;
+                return false;
+            });
+            counts[part] = count;
+        });
+
+        auto result = std::size_t{0};
+        for (const auto count : counts)
+        {
+            result += count;
+        }
+        return result;
+    }
+
+    template <typename Predicate>
+    std::size_t countIf(Predicate&& predicate) const
+    {
+        return countIf(execution::seq, predicate);
+    }
+
+    /**
+     * ID of the first node in storage order matching predicate, 0 if there
+     * is none. Parallel policies give the same node.
+     */
+    template <typename Policy,
+              typename Predicate,
+              typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    uint32_t findIf(Policy policy, Predicate&& predicate) const
+    {
+        const auto slots = m_nodes.slotCount();
+        auto found = std::vector<uint32_t>(utils::partCount(policy, slots), 0);
+        auto firstFoundPart = std::atomic<std::size_t>{found.size()};
+        utils::forEachPart(found.size(), slots, [&](std::size_t part, std::size_t first, std::size_t last)
+        {
+            m_nodes.forEachInSlots(first, last, [&](uint32_t nodeId, const auto& node)
+            {
+                if (firstFoundPart.load(std::memory_order_relaxed) < part)
+                {
+                    return true;
+                }
+                else if (!callWithValue(predicate, nodeId, node))
+                {
+                    return false;
+                }
+
+                found[part] = nodeId;
+                auto expected = firstFoundPart.load(std::memory_order_relaxed);
+                while (part < expected && !firstFoundPart.compare_exchange_weak(expected, part)) {}
+                return true;
+            });
+        });
+
+        for (const auto nodeId : found)
+        {
+            if (nodeId != 0)
+            {
+                return nodeId;
+            }
+        }
+        return 0;
+    }
+
+    template <typename Predicate>
+    uint32_t findIf(Predicate&& predicate) const
+    {
+        return findIf(execution::seq, predicate);
+    }
+
     void clear()
     {
+        ++m_topologyVersion;
         m_current = 0;
         m_nodes.clear();
         m_edges.clear();
+        m_edgeIndex.clear();
+        if (m_connectivity)
+        {
+            m_connectivity->clear();
+        }
+        if (m_valueIndex)
+        {
+            m_valueIndex->clear();
+        }
+        if (m_changeLog)
+        {
+            m_changeLog->clear();
+        }
+        endOperation();
     }
 
-private:
-    template <typename Container, typename T>
-    bool contains(const Container& container, const T& element)
+    /** Replaces node description, returns false if there is no such node. */
+    bool edit(uint32_t nodeId, NodeDescription description)
     {
-        return container.find(element) != container.end();
+        const auto nodeIt = m_nodes.find(nodeId);
+        if (nodeIt == m_nodes.end())
+        {
+            return false;
+        }
+
+        ++m_descriptionVersion;
+        auto& value = nodeIt->second.edit();
+        if (m_valueIndex)
+        {
+            m_valueIndex->erase(nodeId, value);
+            m_valueIndex->insert(nodeId, description);
+        }
+        value = std::move(description);
+        if (m_changeLog)
+        {
+            m_changeLog->edit(nodeId, value);
+        }
+        endOperation();
+        return true;
     }
 
-    static uint32_t nodeIdGenerator()
+    /** IDs of all nodes with given description. */
+    std::vector<uint32_t> findAll(const NodeDescription& description) const
     {
-        static uint32_t id = 0;
-        return ++id;
+        if (m_valueIndex)
+        {
+            const auto* ids = m_valueIndex->find(description);
+            return ids ? std::vector<uint32_t>(ids->begin(), ids->end()) : std::vector<uint32_t>{};
+        }
+
+        auto result = std::vector<uint32_t>{};
+        for (const auto& item : m_nodes)
+        {
+            if (item.second.value() == description)
+            {
+                result.push_back(item.first);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Keeps node IDs by description, so lookups by value (findAll, tie and
+     * MeshBuilder::hopTo by value) do not scan the mesh. Descriptions have to
+     * be hashable with Hash. Indexed descriptions should be changed by edit(),
+     * not through the node itself.
+     */
+    template <typename Hash = std::hash<NodeDescription>, typename Equal = std::equal_to<NodeDescription>>
+    void enableValueIndex()
+    {
+        setValueIndex(std::make_unique<utils::ValueIndex<NodeDescription, Hash, Equal>>(m_resource));
     }
 
-    static uint32_t edgeIdGenerator()
+    void disableValueIndex()
     {
-        static uint32_t id = 0;
-        return ++id;
+        m_valueIndex.reset();
     }
 
-    bool isIntersection(const U32Set& lhs, const U32Set& rhs)
+    bool hasValueIndex() const
+    {
+        return m_valueIndex != nullptr;
+    }
+
+    uint32_t edgeBetween(uint32_t firstNodeId, uint32_t secondNodeId) const
+    {
+        const auto it = m_edgeIndex.find(endpointsKey(firstNodeId, secondNodeId));
+        return it != m_edgeIndex.end() ? it->second : 0;
+    }
+
+    /**
+     * Keeps connected components up to date on every attach, tie and detach,
+     * so detach picks the surviving branch without searching the mesh.
+     * Costs extra memory and O(log^2 n) amortized per edge update.
+     */
+    void enableConnectivityIndex()
+    {
+        if (m_connectivity)
+        {
+            return;
+        }
+
+        m_connectivity = std::make_unique<utils::DynamicConnectivity>(m_resource);
+        for (const auto& edge : m_edges)
+        {
+            const auto& endpoints = edge.second.nodes();
+            m_connectivity->insertEdge(denseIndex(edge.first),
+                                       denseIndex(endpoints.first),
+                                       denseIndex(endpoints.second));
+        }
+    }
+
+    void disableConnectivityIndex()
+    {
+        m_connectivity.reset();
+    }
+
+    bool hasConnectivityIndex() const
+    {
+        return m_connectivity != nullptr;
+    }
+
+    /** Changes on every node or edge insertion and removal. */
+    uint64_t topologyVersion() const
+    {
+        return m_topologyVersion;
+    }
+
+    /**
+     * Caches results of unweighted path queries (and of MeshBuilder sequence
+     * queries given a fingerprint) in a least recently used cache holding at
+     * most capacity node IDs. Any change of the mesh makes entries stale.
+     */
+    void enablePathCache(std::size_t capacity = std::size_t{1} << 20)
+    {
+        m_pathCache = std::make_unique<utils::PathCache>(capacity, m_resource);
+    }
+
+    void disablePathCache()
+    {
+        m_pathCache.reset();
+    }
+
+    bool hasPathCache() const
+    {
+        return m_pathCache != nullptr;
+    }
+
+    /** Hits and misses of the path cache since it was enabled. */
+    utils::PathCache::Stats pathCacheStats() const
+    {
+        return m_pathCache ? m_pathCache->stats() : utils::PathCache::Stats{0, 0};
+    }
+
+    /**
+     * Precomputes hop distances from count landmark nodes (ALT). Path queries
+     * then run A* guided by landmark bounds. After topology changes the next
+     * query starts rebuilding landmarks in the background and searches
+     * without them until the rebuild is done.
+     */
+    void enableLandmarks(uint32_t count = 16)
+    {
+        m_landmarks = std::make_unique<utils::LandmarkIndex>(count);
+        m_landmarks->rebuild(adjacencySnapshot(m_resource), m_topologyVersion);
+    }
+
+    void disableLandmarks()
+    {
+        m_landmarks.reset();
+    }
+
+    bool hasLandmarks() const
+    {
+        return m_landmarks != nullptr;
+    }
+
+    /** Lower and upper bound of hop distance between nodes, if landmarks are up to date. */
+    std::optional<U32Pair> distanceBounds(uint32_t firstNodeId, uint32_t secondNodeId)
+    {
+        const auto* landmarks = currentLandmarks();
+        if (!landmarks || !contains(m_nodes, firstNodeId) || !contains(m_nodes, secondNodeId))
+        {
+            return {};
+        }
+
+        const auto first = denseIndex(firstNodeId);
+        const auto second = denseIndex(secondNodeId);
+        return U32Pair{landmarks->lowerBound(first, second), landmarks->upperBound(first, second)};
+    }
+
+    bool isReachable(uint32_t firstNodeId, uint32_t secondNodeId) const
+    {
+        if (!contains(m_nodes, firstNodeId) || !contains(m_nodes, secondNodeId))
+        {
+            return false;
+        }
+        else if (m_connectivity)
+        {
+            return m_connectivity->connected(denseIndex(firstNodeId), denseIndex(secondNodeId));
+        }
+        return m_bfs.use([&](auto& bfs) { return bfs.reachable(Adjacency{*this}, firstNodeId, secondNodeId); });
+    }
+
+    /** Maps every node ID to its component number, components are numbered from 1. */
+    U32U32Map components() const
+    {
+        auto labels = U32U32Map{m_resource};
+        labels.reserve(m_nodes.size());
+        m_bfs.use([&](auto& bfs)
+        {
+            return bfs.components(Adjacency{*this}, [&labels](uint32_t nodeId, uint32_t label) { labels.emplace(nodeId, label); });
+        });
+        return labels;
+    }
+
+private:
+    template <typename Container, typename T>
+    bool contains(const Container& container, const T& element) const
+    {
+        return container.find(element) != container.end();
+    }
+
+    template <typename LhsSet, typename RhsSet>
+    bool isIntersection(const LhsSet& lhs, const RhsSet& rhs)
     {
         return intersectionPoint(lhs, rhs) != 0;
     }
 
-    uint32_t intersectionPoint(const U32Set& lhs, const U32Set& rhs)
+    template <typename LhsSet, typename RhsSet>
+    uint32_t intersectionPoint(const LhsSet& lhs, const RhsSet& rhs)
     {
         if (lhs.size() < rhs.size())
         {
@@ -317,38 +808,115 @@ private:
         return 0;
     }
 
-    std::pair<U32Set, U32Set> dfs(uint32_t nodeId)
+    template <typename Function, typename Item>
+    static decltype(auto) callWithValue(Function& function, uint32_t id, const Item& item)
     {
-        auto visitedNodes = U32Set{};
-        auto visitedEdges = U32Set{};
+        if constexpr (std::is_invocable_v<Function&, uint32_t, decltype(item.value())>)
+        {
+            return function(id, item.value());
+        }
+        else
+        {
+            return function(item.value());
+        }
+    }
 
-        auto toVisit = std::vector<uint32_t>{nodeId};
-        while (!toVisit.empty())
+    template <typename Policy, typename Items, typename Function>
+    void forEachItem(Policy policy, const Items& items, Function& function) const
+    {
+        const auto slots = items.slotCount();
+        utils::forEachPart(utils::partCount(policy, slots), slots, [&](std::size_t, std::size_t first, std::size_t last)
         {
-            const auto nodeId = toVisit.back();
-            toVisit.pop_back();
-            visitedNodes.insert(nodeId);
+            items.forEachInSlots(first, last, [&](uint32_t id, const auto& item)
+            {
+                callWithValue(function, id, item);
+                return false;
+            });
+        });
+    }
 
-            for (const auto edgeId : m_nodes[nodeId].edges())
+    void setValueIndex(std::unique_ptr<utils::IValueIndex<NodeDescription>> valueIndex)
+    {
+        m_valueIndex = std::move(valueIndex);
+        for (const auto& node : m_nodes)
+        {
+            m_valueIndex->insert(node.first, node.second.value());
+        }
+    }
+
+    uint32_t anyNodeWith(const NodeDescription& description) const
+    {
+        if (m_valueIndex)
+        {
+            const auto* ids = m_valueIndex->find(description);
+            return ids ? ids->front() : 0;
+        }
+
+        for (const auto& item : m_nodes)
+        {
+            if (item.second.value() == description)
+            {
+                return item.first;
+            }
+        }
+        return 0;
+    }
+
+    class Adjacency
+    {
+    public:
+        explicit Adjacency(const Mesh& mesh)
+            : m_mesh{mesh}
+        {}
+
+        uint32_t indexBound() const { return m_mesh.m_nodes.indexBound(); }
+        uint32_t index(uint32_t nodeId) const { return denseIndex(nodeId); }
+        std::size_t degree(uint32_t nodeId) const { return m_mesh.m_nodes.find(nodeId)->second.edges().size(); }
+        std::size_t arcCount() const { return 2 * m_mesh.m_edges.size(); }
+
+        template <typename Function>
+        bool forEachNeighbour(uint32_t nodeId, Function&& function) const
+        {
+            for (const auto edgeId : m_mesh.m_nodes.find(nodeId)->second.edges())
             {
-                if (contains(visitedEdges, edgeId))
+                const auto& endpoints = m_mesh.m_edges.find(edgeId)->second.nodes();
+                if (function(endpoints.first == nodeId ? endpoints.second : endpoints.first))
                 {
-                    continue;
+                    return true;
                 }
-                visitedEdges.insert(edgeId);
+            }
+            return false;
+        }
 
-                auto nextNode = m_edges[edgeId].nodes().first == nodeId ?
-                                m_edges[edgeId].nodes().second :
-                                m_edges[edgeId].nodes().first;
+        template <typename Function>
+        void forEachVertex(Function&& function) const
+        {
+            for (const auto& item : m_mesh.m_nodes)
+            {
+                function(item.first);
+            }
+        }
 
-                if (!contains(visitedNodes, nextNode))
+    private:
+        const Mesh& m_mesh;
+    };
+
+    std::pair<U32Vector, U32Vector> branch(uint32_t nodeId)
+    {
+        auto visitedNodes = m_bfs.use([&](auto& bfs) { return bfs.reach(Adjacency{*this}, nodeId); });
+        auto visitedEdges = U32Vector{m_resource};
+        for (const auto visitedId : visitedNodes)
+        {
+            for (const auto edgeId : m_nodes[visitedId].edges())
+            {
+                if (m_edges[edgeId].nodes().first == visitedId)
                 {
-                    toVisit.push_back(nextNode);
+                    visitedEdges.push_back(edgeId);
                 }
             }
         }
 
-        return {visitedNodes, visitedEdges};
+        return {std::move(visitedNodes), std::move(visitedEdges)};
     }
 
     std::pair<bool, int> bidirectionalAStart(const uint32_t leftBranchRoot,
@@ -361,11 +929,11 @@ private:
         constexpr auto LEFT_BRANCH_IS_BIGGER = -1;
         constexpr auto RIGHT_BRANCH_IS_BIGGER = 1;
 
-        auto visitedBegin = U32Set{};
-        auto visitedEnd = U32Set{};
+        auto visitedBegin = U32Set{m_resource};
+        auto visitedEnd = U32Set{m_resource};
 
-        auto pQueueLeftBranch = U32PairPriorityQueue{};
-        auto pQueueRightBranch = U32PairPriorityQueue{};
+        auto pQueueLeftBranch = U32PairPriorityQueue{m_resource};
+        auto pQueueRightBranch = U32PairPriorityQueue{m_resource};
 
         pQueueLeftBranch.push({0, leftBranchRoot});
         pQueueRightBranch.push({0, rightBranchRoot});
@@ -422,75 +990,130 @@ private:
         }
     }
 
-    std::vector<uint32_t> bidirectionalAStart(const uint32_t leftBranchRoot,
-                                              const uint32_t rightBranchRoot)
+    void shortestPath(uint32_t begin, uint32_t end, std::vector<uint32_t>& path)
     {
-        auto visitedBegin = U32Set{};
-        auto visitedEnd = U32Set{};
-        auto nodeToParentMapBegin = U32PairMap{};
-        auto nodeToParentMapEnd = U32PairMap{};
-
-        auto pQueueLeftBranch = U32PairPriorityQueue{};
-        auto pQueueRightBranch = U32PairPriorityQueue{};
-
-        pQueueLeftBranch.push({0, leftBranchRoot});
-        pQueueRightBranch.push({0, rightBranchRoot});
+        const auto key = (uint64_t{begin} << 32) | end;
+        if (m_pathCache && m_pathCache->find(utils::PathCache::Kind::PATH, key, m_topologyVersion, path))
+        {
+            return;
+        }
 
-        while (!pQueueLeftBranch.empty() && !pQueueRightBranch.empty())
+        searchShortestPath(begin, end, path);
+        if (m_pathCache)
         {
-            auto [bPrio, begin] = pQueueLeftBranch.top();
-            pQueueLeftBranch.pop();
-            auto [ePrio, end] = pQueueRightBranch.top();
-            pQueueRightBranch.pop();
+            m_pathCache->insert(utils::PathCache::Kind::PATH, key, m_topologyVersion, path);
+        }
+    }
 
-            visitedBegin.insert(begin);
-            visitedEnd.insert(end);
+    void searchShortestPath(uint32_t begin, uint32_t end, std::vector<uint32_t>& path)
+    {
+        const auto* landmarks = currentLandmarks();
+        if (!landmarks)
+        {
+            m_pathSearch.shortestPath(Adjacency{*this}, begin, end, path);
+            return;
+        }
 
-            auto commonNode = intersectionPoint(visitedBegin, visitedEnd);
-            if (commonNode != 0)
-            {
-                auto result = std::vector<uint32_t>{};
+        const auto beginIndex = denseIndex(begin);
+        const auto endIndex = denseIndex(end);
+        if (landmarks->separated(beginIndex, endIndex))
+        {
+            path.clear();
+            return;
+        }
 
-                while (nodeToParentMapBegin[commonNode] != 0)
-                {
-                    result.push_back(nodeToParentMapBegin[begin]);
-                }
+        const auto potential = [landmarks, beginIndex, endIndex](uint32_t nodeId)
+        {
+            const auto nodeIndex = denseIndex(nodeId);
+            return (static_cast<double>(landmarks->lowerBound(nodeIndex, endIndex)) -
+                    static_cast<double>(landmarks->lowerBound(nodeIndex, beginIndex))) / 2;
+        };
+        const auto unitWeight = [](const EdgeDescription&) { return 1.0; };
+        weightedPath(begin, end, unitWeight, potential, path);
+    }
 
-                result = std::vector(result.rbegin(), result.rend());
+    const utils::Landmarks* currentLandmarks()
+    {
+        if (!m_landmarks)
+        {
+            return nullptr;
+        }
 
-                while (nodeToParentMapBegin[commonNode] != 0)
-                {
-                    result.push_back(nodeToParentMapBegin[begin]);
-                }
+        const auto* landmarks = m_landmarks->current(m_topologyVersion);
+        if (!landmarks && !m_landmarks->isRefreshing())
+        {
+            m_landmarks->refresh(adjacencySnapshot(std::pmr::new_delete_resource()), m_topologyVersion);
+        }
+        return landmarks;
+    }
 
-                return result;
-            }
+    utils::AdjacencySnapshot adjacencySnapshot(std::pmr::memory_resource* resource) const
+    {
+        auto snapshot = utils::AdjacencySnapshot{resource};
+        const auto indexBound = m_nodes.indexBound();
+        snapshot.offsets.assign(indexBound + 1, 0);
+        snapshot.vertices.reserve(m_nodes.size());
+        for (const auto& node : m_nodes)
+        {
+            snapshot.vertices.push_back(denseIndex(node.first));
+            snapshot.offsets[denseIndex(node.first) + 1] = static_cast<uint32_t>(node.second.edges().size());
+        }
+        for (auto i = 0u; i < indexBound; ++i)
+        {
+            snapshot.offsets[i + 1] += snapshot.offsets[i];
+        }
 
-            for (const auto bConnect : getConnectedNodes(begin))
+        snapshot.neighbours.resize(snapshot.offsets.back());
+        for (const auto& node : m_nodes)
+        {
+            auto position = snapshot.offsets[denseIndex(node.first)];
+            for (const auto edgeId : node.second.edges())
             {
-                if (!contains(visitedBegin, bConnect))
-                {
-                    pQueueLeftBranch.push({bPrio + 1, bConnect});
-                    nodeToParentMapBegin[bConnect] = begin;
-                }
+                const auto& endpoints = m_edges.find(edgeId)->second.nodes();
+                snapshot.neighbours[position++] = denseIndex(endpoints.first == node.first ? endpoints.second : endpoints.first);
             }
+        }
+        return snapshot;
+    }
 
-            for (const auto eConnect : getConnectedNodes(end))
+    template <typename Weight>
+    void cheapestPath(uint32_t begin, uint32_t end, Weight&& weight, std::vector<uint32_t>& path)
+    {
+        weightedPath(begin, end, weight, [](uint32_t) { return 0.0; }, path);
+    }
+
+    template <typename Weight, typename Heuristic>
+    void cheapestPath(uint32_t begin, uint32_t end, Weight&& weight, Heuristic&& heuristic, std::vector<uint32_t>& path)
+    {
+        const auto& beginValue = m_nodes.find(begin)->second.value();
+        const auto& endValue = m_nodes.find(end)->second.value();
+        const auto potential = [&](uint32_t nodeId)
+        {
+            const auto& value = m_nodes.find(nodeId)->second.value();
+            return (heuristic(value, endValue) - heuristic(value, beginValue)) / 2;
+        };
+        weightedPath(begin, end, weight, potential, path);
+    }
+
+    template <typename Weight, typename Potential>
+    void weightedPath(uint32_t begin, uint32_t end, Weight& weight, const Potential& potential, std::vector<uint32_t>& path)
+    {
+        const auto forEachArc = [this, &weight](uint32_t nodeId, auto&& visitArc)
+        {
+            for (const auto edgeId : m_nodes.find(nodeId)->second.edges())
             {
-                if (!contains(visitedEnd, eConnect))
-                {
-                    pQueueRightBranch.push({ePrio + 1, eConnect});
-                    nodeToParentMapEnd[eConnect] = begin;
-                }
+                const auto& edge = m_edges.find(edgeId)->second;
+                const auto& endpoints = edge.nodes();
+                visitArc(endpoints.first == nodeId ? endpoints.second : endpoints.first,
+                         static_cast<double>(weight(edge.value())));
             }
-        }
-
-        return {};
+        };
+        m_pathSearch.cheapestPath(Adjacency{*this}, begin, end, forEachArc, potential, path);
     }
 
-    std::vector<uint32_t> getConnectedNodes(uint32_t nodeId)
+    U32Vector getConnectedNodes(uint32_t nodeId)
     {
-        auto result = std::vector<uint32_t>{};
+        auto result = U32Vector{m_resource};
         result.reserve(m_nodes[nodeId].edges().size());
 
         for (const auto edgeId : m_nodes[nodeId].edges())
@@ -508,18 +1131,117 @@ private:
         return result;
     }
 
+    /**
+     * Removes all doomed nodes at once. Every component touched by them is
+     * swept once to label what is left of it, the biggest remaining piece
+     * survives and the other pieces are erased together with doomed nodes.
+     */
+    void detachBatch(U32Set doomedNodes)
+    {
+        auto erasedNodes = U32Vector{m_resource};
+        auto visited = U32Set{m_resource};
+        auto placed = U32Set{m_resource};
+        auto survivors = U32Vector{m_resource};
+        auto pieces = U32Vector{m_resource};
+        auto toVisit = U32Vector{m_resource};
+
+        for (const auto doomedId : doomedNodes)
+        {
+            erasedNodes.push_back(doomedId);
+            if (!visited.insert(doomedId).second)
+            {
+                continue;
+            }
+
+            survivors.clear();
+            toVisit.push_back(doomedId);
+            while (!toVisit.empty())
+            {
+                const auto nodeId = toVisit.back();
+                toVisit.pop_back();
+                if (!contains(doomedNodes, nodeId))
+                {
+                    survivors.push_back(nodeId);
+                }
+                for (const auto edgeId : m_nodes[nodeId].edges())
+                {
+                    const auto nextNode = otherEndpoint(edgeId, nodeId);
+                    if (visited.insert(nextNode).second)
+                    {
+                        toVisit.push_back(nextNode);
+                    }
+                }
+            }
+
+            pieces.clear();
+            auto biggestBegin = std::size_t{0};
+            auto biggestEnd = std::size_t{0};
+            for (const auto survivorId : survivors)
+            {
+                if (!placed.insert(survivorId).second)
+                {
+                    continue;
+                }
+
+                const auto pieceBegin = pieces.size();
+                pieces.push_back(survivorId);
+                for (auto i = pieceBegin; i < pieces.size(); ++i)
+                {
+                    for (const auto edgeId : m_nodes[pieces[i]].edges())
+                    {
+                        const auto nextNode = otherEndpoint(edgeId, pieces[i]);
+                        if (!contains(doomedNodes, nextNode) && placed.insert(nextNode).second)
+                        {
+                            pieces.push_back(nextNode);
+                        }
+                    }
+                }
+
+                if (pieces.size() - pieceBegin > biggestEnd - biggestBegin)
+                {
+                    biggestBegin = pieceBegin;
+                    biggestEnd = pieces.size();
+                }
+            }
+
+            erasedNodes.insert(erasedNodes.end(), pieces.begin(), pieces.begin() + biggestBegin);
+            erasedNodes.insert(erasedNodes.end(), pieces.begin() + biggestEnd, pieces.end());
+        }
+
+        for (const auto nodeId : erasedNodes)
+        {
+            for (const auto edgeId : m_nodes[nodeId].edges())
+            {
+                m_nodes[otherEndpoint(edgeId, nodeId)].edges().erase(edgeId);
+                eraseEdge(edgeId);
+            }
+            eraseNode(nodeId);
+        }
+
+        if (!contains(m_nodes, m_current))
+        {
+            m_current = 0;
+        }
+    }
+
+    uint32_t otherEndpoint(uint32_t edgeId, uint32_t nodeId)
+    {
+        const auto& endpoints = m_edges[edgeId].nodes();
+        return endpoints.first == nodeId ? endpoints.second : endpoints.first;
+    }
+
     void deleteBranch(uint32_t nodeId, U32Set& leaves)
     {
-        auto [visitedNodes, visitedEdges] = dfs(nodeId);
+        auto [visitedNodes, visitedEdges] = branch(nodeId);
 
         for (const auto edgeId : visitedEdges)
         {
-            m_edges.erase(edgeId);
+            eraseEdge(edgeId);
         }
 
         for (const auto nodeId : visitedNodes)
         {
-            m_nodes.erase(nodeId);
+            eraseNode(nodeId);
             leaves.erase(nodeId);
         }
     }
@@ -547,26 +1269,221 @@ private:
         }
     }
 
-    uint32_t insertNode(NodeDescription description)
+    void rebranchIndexed(U32Set leaves)
     {
-        auto node = objects::Node{std::move(description)};
-        auto nodeId = nodeIdGenerator();
-        m_nodes.insert({nodeId, std::move(node)});
+        auto branches = std::pmr::unordered_map<uint64_t, uint32_t>{m_resource};
+        auto biggestBranch = 0u;
+        auto biggestSize = 0u;
+        for (const auto leaf : leaves)
+        {
+            const auto index = denseIndex(leaf);
+            if (!branches.insert({m_connectivity->component(index), leaf}).second)
+            {
+                continue;
+            }
+
+            const auto size = m_connectivity->componentSize(index);
+            if (size > biggestSize)
+            {
+                biggestBranch = leaf;
+                biggestSize = size;
+            }
+        }
+
+        for (const auto& branch : branches)
+        {
+            if (branch.second != biggestBranch)
+            {
+                dropBranch(branch.second);
+            }
+        }
+    }
+
+    void dropBranch(uint32_t nodeId)
+    {
+        auto [visitedNodes, visitedEdges] = branch(nodeId);
+
+        auto nodeIndices = U32Vector{m_resource};
+        auto edgeIndices = U32Vector{m_resource};
+        nodeIndices.reserve(visitedNodes.size());
+        edgeIndices.reserve(visitedEdges.size());
+        for (const auto visitedId : visitedNodes)
+        {
+            nodeIndices.push_back(denseIndex(visitedId));
+        }
+        for (const auto visitedId : visitedEdges)
+        {
+            edgeIndices.push_back(denseIndex(visitedId));
+        }
+        m_connectivity->eraseComponent(nodeIndices, edgeIndices);
+
+        for (const auto edgeId : visitedEdges)
+        {
+            eraseEdge(edgeId);
+        }
+        for (const auto visitedId : visitedNodes)
+        {
+            eraseNode(visitedId, false);
+        }
+    }
+
+    /**
+     * Node under a fresh ID, or under reservedId when it is given (restored
+     * from a file or a log), 0 when reservedId is invalid or its index is live.
+     */
+    uint32_t insertNode(NodeDescription description, uint32_t reservedId = 0)
+    {
+        auto node = objects::Node{std::move(description), m_resource};
+        auto nodeId = reservedId;
+        if (reservedId == 0)
+        {
+            nodeId = m_nodes.insert(std::move(node));
+        }
+        else if (!isValidId(reservedId) || !m_nodes.insert(reservedId, std::move(node)))
+        {
+            return 0;
+        }
+
+        ++m_topologyVersion;
+        if (m_valueIndex)
+        {
+            m_valueIndex->insert(nodeId, m_nodes.find(nodeId)->second.value());
+        }
+        if (m_changeLog)
+        {
+            m_changeLog->insertNode(nodeId, m_nodes.find(nodeId)->second.value());
+        }
         return nodeId;
     }
 
-    uint32_t insertEdge(U32Pair endpointNodes, EdgeDescription description)
+    /** As insertNode, endpoint adjacency is left to the caller. */
+    uint32_t insertEdge(U32Pair endpointNodes, EdgeDescription description, uint32_t reservedId = 0)
     {
         auto edge = objects::Edge{std::move(description)};
-        auto edgeId = edgeIdGenerator();
         edge.nodes() = endpointNodes;
-        m_edges.insert({edgeId, std::move(edge)});
+        auto edgeId = reservedId;
+        if (reservedId == 0)
+        {
+            edgeId = m_edges.insert(std::move(edge));
+        }
+        else if (!isValidId(reservedId) || !m_edges.insert(reservedId, std::move(edge)))
+        {
+            return 0;
+        }
+
+        ++m_topologyVersion;
+        m_edgeIndex[endpointsKey(endpointNodes.first, endpointNodes.second)] = edgeId;
+        if (m_connectivity)
+        {
+            m_connectivity->insertEdge(denseIndex(edgeId),
+                                       denseIndex(endpointNodes.first),
+                                       denseIndex(endpointNodes.second));
+        }
+        if (m_changeLog)
+        {
+            m_changeLog->insertEdge(edgeId, endpointNodes.first, endpointNodes.second,
+                                    m_edges.find(edgeId)->second.value());
+        }
         return edgeId;
     }
 
+    /** Leaves the connectivity index alone when told so, for callers which erase whole components from it. */
+    void eraseNode(uint32_t nodeId, bool updateConnectivity = true)
+    {
+        const auto nodeIt = m_nodes.find(nodeId);
+        if (nodeIt == m_nodes.end())
+        {
+            return;
+        }
+
+        if (m_valueIndex)
+        {
+            m_valueIndex->erase(nodeId, nodeIt->second.value());
+        }
+        m_nodes.erase(nodeId);
+        ++m_topologyVersion;
+        if (m_connectivity && updateConnectivity)
+        {
+            m_connectivity->eraseVertex(denseIndex(nodeId));
+        }
+        if (m_changeLog)
+        {
+            m_changeLog->eraseNode(nodeId);
+        }
+    }
+
+    void eraseEdge(uint32_t edgeId)
+    {
+        const auto edgeIt = m_edges.find(edgeId);
+        if (edgeIt == m_edges.end())
+        {
+            return;
+        }
+
+        ++m_topologyVersion;
+        const auto& endpoints = edgeIt->second.nodes();
+        m_edgeIndex.erase(endpointsKey(endpoints.first, endpoints.second));
+        if (m_connectivity)
+        {
+            m_connectivity->eraseEdge(denseIndex(edgeId));
+        }
+        m_edges.erase(edgeId);
+        if (m_changeLog)
+        {
+            m_changeLog->eraseEdge(edgeId);
+        }
+    }
+
+    /** Called when a public change is done, the change log sees a consistent mesh then. */
+    void endOperation()
+    {
+        if (m_changeLog)
+        {
+            m_changeLog->operationEnd();
+        }
+    }
+
+    /** Rebuilds ID allocation of both storages after inserts under reserved IDs. */
+    void restoreIds()
+    {
+        m_nodes.restoreIds();
+        m_edges.restoreIds();
+    }
+
+    static bool isValidId(uint32_t id)
+    {
+        return (id & objects::GenerationalId::INDEX_MASK) != 0;
+    }
+
+    static uint32_t denseIndex(uint32_t id)
+    {
+        return objects::GenerationalId::index(id);
+    }
+
+    static uint64_t endpointsKey(uint32_t firstNodeId, uint32_t secondNodeId)
+    {
+        if (firstNodeId > secondNodeId)
+        {
+            std::swap(firstNodeId, secondNodeId);
+        }
+        return (uint64_t{firstNodeId} << 32) | secondNodeId;
+    }
+
 private:
+    std::pmr::memory_resource* m_resource;
     U32NodeMap m_nodes;
     U32EdgeMap m_edges;
+    U64U32Map m_edgeIndex;
+    std::unique_ptr<utils::DynamicConnectivity> m_connectivity;
+    utils::PathSearch m_pathSearch;
+    utils::HopSearch m_hopSearch;
+    utils::ParallelBfsCache m_bfs;
+    std::unique_ptr<utils::LandmarkIndex> m_landmarks;
+    std::unique_ptr<utils::IValueIndex<NodeDescription>> m_valueIndex;
+    std::unique_ptr<utils::PathCache> m_pathCache;
+    utils::IChangeLog<NodeDescription, EdgeDescription>* m_changeLog;
+    uint64_t m_topologyVersion;
+    uint64_t m_descriptionVersion;
     uint32_t m_current;
 };
 
@@ -5,21 +5,26 @@
 
 #include <optional>
 #include <set>
+#include <type_traits>
 
 #include "mesh.hpp"
+#include "utils/sequencematch.hpp"
 
 
 namespace mesh
 {
 
-template <typename NodeDescription, typename EdgeDescription>
+template <typename NodeDescription, typename EdgeDescription, typename Storage>
 class MeshBuilder
 {
     using NodePredicate = std::function<bool(const objects::Node<NodeDescription>&)>;
     using NodePredicateVec = std::vector<std::function<bool(const objects::Node<NodeDescription>&)>>;
+    using EdgeWeight = std::function<double(const EdgeDescription&)>;
+    using NodeHeuristic = std::function<double(const NodeDescription&, const NodeDescription&)>;
+    using SequenceMatch = utils::SequenceMatch<typename Mesh<NodeDescription, EdgeDescription, Storage>::Adjacency>;
 
 public:
-    explicit MeshBuilder(Mesh<NodeDescription, EdgeDescription>& mesh)
+    explicit MeshBuilder(Mesh<NodeDescription, EdgeDescription, Storage>& mesh)
         : m_mesh{mesh}
     {}
 
@@ -112,6 +117,18 @@ public:
         return *this;
     }
 
+    /**
+     * Hops to a node with given description, any of them if there are more.
+     * Not available for arithmetic descriptions, which would clash with node IDs.
+     */
+    template <typename Value = NodeDescription,
+              typename = std::enable_if_t<!std::is_arithmetic<Value>::value>>
+    MeshBuilder& hopTo(const NodeDescription& description)
+    {
+        m_mesh.m_current = m_mesh.anyNodeWith(description);
+        return *this;
+    }
+
     MeshBuilder& hopToPathEnd(const std::vector<uint32_t>& pathIds)
     {
         if (pathIds.empty())
@@ -137,35 +154,80 @@ public:
 
     MeshBuilder& hopToPathEnd(const NodePredicateVec& predicates)
     {
-        if (predicates.empty())
+        return hopToPathEnd(execution::seq, predicates);
+    }
+
+    /**
+     * Parallel policies match big layers on several threads, predicates
+     * could be called from several threads at once then.
+     */
+    template <typename Policy, typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    MeshBuilder& hopToPathEnd(Policy policy, const NodePredicateVec& predicates)
+    {
+        auto sequence = sequenceMatch();
+        auto pathIds = std::vector<uint32_t>{};
+        if (matchSequence(policy, sequence, predicates))
         {
-            m_mesh.m_current = 0;
-            return *this;
+            sequence.firstWalk(pathIds);
         }
 
-        auto nodeIds = std::vector<uint32_t>{};
-        const auto firstPredicate = predicates[0];
-        const auto firstPredicateWrapper = [&firstPredicate](const auto& item) { return firstPredicate(item.second); };
+        m_mesh.m_current = pathIds.empty() ? 0 : pathIds.back();
+        return *this;
+    }
 
-        auto it = std::find_if(m_mesh.m_nodes.cbegin(), m_mesh.m_nodes.cend(), firstPredicateWrapper);
-        while (it != m_mesh.m_nodes.cend())
+    /**
+     * Same as above, results are cached under fingerprint when the mesh has
+     * a path cache. Equal fingerprints have to mean equal predicates.
+     */
+    MeshBuilder& hopToPathEnd(const NodePredicateVec& predicates, uint64_t fingerprint)
+    {
+        return hopToPathEnd(execution::seq, predicates, fingerprint);
+    }
+
+    template <typename Policy, typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    MeshBuilder& hopToPathEnd(Policy policy, const NodePredicateVec& predicates, uint64_t fingerprint)
+    {
+        auto& cache = m_mesh.m_pathCache;
+        const auto epoch = m_mesh.m_topologyVersion + m_mesh.m_descriptionVersion;
+        auto pathIds = std::vector<uint32_t>{};
+        if (!cache || !cache->find(utils::PathCache::Kind::SEQUENCE, fingerprint, epoch, pathIds))
         {
-            const auto currentNodeId = it->first;
-            const auto lastNodeId = pathLastNodeId(predicates, currentNodeId);
-            if (lastNodeId != 0)
+            hopToPathEnd(policy, predicates);
+            if (m_mesh.m_current != 0)
             {
-                m_mesh.m_current = lastNodeId;
-                return *this;
+                pathIds.push_back(m_mesh.m_current);
             }
-
-            ++it;
-            it = std::find_if(it, m_mesh.m_nodes.cend(), firstPredicateWrapper);
+            if (cache)
+            {
+                cache->insert(utils::PathCache::Kind::SEQUENCE, fingerprint, epoch, pathIds);
+            }
+            return *this;
         }
 
-        m_mesh.m_current = 0;
+        m_mesh.m_current = pathIds.empty() ? 0 : pathIds.back();
         return *this;
     }
 
+    /** End node IDs of all paths whose nodes match predicates one by one. */
+    std::vector<uint32_t> pathEnds(const NodePredicateVec& predicates)
+    {
+        return pathEnds(execution::seq, predicates);
+    }
+
+    /** Predicates could be called from several threads at once with parallel policies. */
+    template <typename Policy, typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    std::vector<uint32_t> pathEnds(Policy policy, const NodePredicateVec& predicates)
+    {
+        auto sequence = sequenceMatch();
+        if (!matchSequence(policy, sequence, predicates))
+        {
+            return {};
+        }
+
+        const auto& ends = sequence.ends();
+        return {ends.begin(), ends.end()};
+    }
+
     MeshBuilder& hopToUniquePathEnd(const std::vector<uint32_t>& pathIds)
     {
         if (pathIds.size() > m_mesh.m_nodes.size())
@@ -234,31 +296,63 @@ public:
 
     std::vector<uint32_t> pathBetween(uint32_t begin, uint32_t end)
     {
-        auto& nodes = m_mesh.m_nodes;
-        if (begin == end)
+        auto path = std::vector<uint32_t>{};
+        pathBetween(begin, end, path);
+        return path;
+    }
+
+    /** Same as above, but reuses capacity of given path vector. */
+    bool pathBetween(uint32_t begin, uint32_t end, std::vector<uint32_t>& path)
+    {
+        if (needsPathSearch(begin, end, path))
         {
-            return {begin};
+            m_mesh.shortestPath(begin, end, path);
         }
-        else if (!m_mesh.contains(nodes, begin))
+        return !path.empty();
+    }
+
+    /** Cheapest path by edge weights, weights must not be negative. */
+    std::vector<uint32_t> pathBetween(uint32_t begin, uint32_t end, const EdgeWeight& weight)
+    {
+        auto path = std::vector<uint32_t>{};
+        if (needsPathSearch(begin, end, path))
         {
-            return {};
+            m_mesh.cheapestPath(begin, end, weight, path);
         }
-        else if (!m_mesh.contains(nodes, end))
+        return path;
+    }
+
+    /**
+     * A* search, heuristic(from, to) estimates cost between two nodes and has
+     * to be consistent: never above the edge weight plus estimate from the
+     * neighbour.
+     */
+    std::vector<uint32_t> pathBetween(uint32_t begin,
+                                      uint32_t end,
+                                      const EdgeWeight& weight,
+                                      const NodeHeuristic& heuristic)
+    {
+        auto path = std::vector<uint32_t>{};
+        if (needsPathSearch(begin, end, path))
         {
-            return {};
+            m_mesh.cheapestPath(begin, end, weight, heuristic, path);
         }
-
-        return m_mesh.bidirectionalAStart(begin, end);
+        return path;
     }
 
     std::vector<uint32_t> pathBetween(uint32_t begin, const NodePredicate& end)
     {
+        const auto beginIt = m_mesh.m_nodes.find(begin);
+        if (beginIt == m_mesh.m_nodes.end())
+        {
+            return {};
+        }
+
         const auto endPredicateWrapper = [&begin, &end](const auto& item) { return (begin != item.first) && end(item.second); };
         auto endIt = std::find_if(m_mesh.m_nodes.cbegin(), m_mesh.m_nodes.cend(), endPredicateWrapper);
         if (endIt == m_mesh.m_nodes.cend())
         {
-            const auto& beginItem = m_mesh.m_nodes[begin];
-            if (end(beginItem))
+            if (end(beginIt->second))
             {
                 return {begin};
             }
@@ -267,7 +361,7 @@ public:
                 return {};
             }
         }
-        return path(begin, endIt->first);
+        return pathBetween(begin, endIt->first);
     }
 
     std::vector<uint32_t> pathBetween(const NodePredicate& begin, const NodePredicate& end)
@@ -284,10 +378,9 @@ public:
         const auto endIt = std::find_if(m_mesh.m_nodes.cbegin(), m_mesh.m_nodes.cend(), endPredicateWrapper);
         if (endIt == m_mesh.m_nodes.cend())
         {
-            const auto& beginItem = m_mesh.m_nodes[beginNodeId];
-            if (end(beginItem))
+            if (end(beginIt->second))
             {
-                return {begin};
+                return {beginNodeId};
             }
             else
             {
@@ -295,60 +388,40 @@ public:
             }
         }
 
-        return path(beginIt->first, endIt->first);
+        return pathBetween(beginNodeId, endIt->first);
     }
 
 private:
-    bool isConnected(uint32_t firstNodeId, uint32_t secondNodeId)
+    bool needsPathSearch(uint32_t begin, uint32_t end, std::vector<uint32_t>& path)
     {
-        if (!m_mesh.contains(m_mesh.m_nodes, firstNodeId))
+        path.clear();
+        auto& nodes = m_mesh.m_nodes;
+        if (begin == end)
         {
+            path.push_back(begin);
             return false;
         }
+        return m_mesh.contains(nodes, begin) && m_mesh.contains(nodes, end);
+    }
 
-        for (const auto& edgeId : m_mesh.m_nodes[firstNodeId].edges())
-        {
-            const auto& edge = m_mesh.m_edges[edgeId];
-            const auto nodeId = (edge.nodes().first == firstNodeId ?
-                                     edge.nodes().second :
-                                     edge.nodes().first);
-            if (nodeId == secondNodeId)
-            {
-                return true;
-            }
-        }
-        return false;
+    bool isConnected(uint32_t firstNodeId, uint32_t secondNodeId)
+    {
+        return m_mesh.edgeBetween(firstNodeId, secondNodeId) != 0;
     }
 
-    uint32_t pathLastNodeId(const NodePredicateVec& predicates,
-                            uint32_t fromNodeId,
-                            uint32_t depth = 1)
+    SequenceMatch sequenceMatch() const
     {
-        if (depth == predicates.size())
-        {
-            return fromNodeId;
-        }
+        return SequenceMatch{typename Mesh<NodeDescription, EdgeDescription, Storage>::Adjacency{m_mesh}};
+    }
 
-        const auto& currentPredicate = predicates[depth];
-        const auto& outcomingEdgeIds = m_mesh.m_nodes[fromNodeId].edges();
-        for (const auto& edgeId : outcomingEdgeIds)
+    template <typename Policy>
+    bool matchSequence(Policy policy, SequenceMatch& sequence, const NodePredicateVec& predicates) const
+    {
+        const auto& nodes = m_mesh.m_nodes;
+        return sequence.match(policy, predicates.size(), [&](std::size_t depth, uint32_t nodeId)
         {
-            const auto& edge = m_mesh.m_edges[edgeId];
-            const auto nodeId = (edge.nodes().first == fromNodeId ?
-                                     edge.nodes().second :
-                                     edge.nodes().first);
-            const auto& node = m_mesh.m_nodes[nodeId];
-
-            if (currentPredicate(node))
-            {
-                const auto lastNodeId = pathLastNodeId(predicates, nodeId, depth + 1);
-                if (lastNodeId != 0)
-                {
-                    return lastNodeId;
-                }
-            }
-        }
-        return 0;
+            return predicates[depth](nodes.find(nodeId)->second);
+        });
     }
 
     uint32_t uniquePathLastNodeId(const NodePredicate& predicates,
@@ -388,7 +461,7 @@ private:
     }
 
 private:
-    Mesh<NodeDescription, EdgeDescription>& m_mesh;
+    Mesh<NodeDescription, EdgeDescription, Storage>& m_mesh;
 };
 
 }  // namespace mesh
@@ -14,7 +14,7 @@ namespace objects
 {
 
 template <typename Description>
-struct Edge : public IEdge
+struct Edge : public EdgeBase<Description>
 {
     using U32Pair = IMObject::U32Pair;
 
@@ -0,0 +1,40 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <inttypes.h>
+
+
+namespace mesh
+{
+namespace objects
+{
+
+/**
+ * ID layout shared by generational storages: lower bits keep slot index + 1
+ * (so 0 is never a valid ID), upper bits keep slot generation. IDs stay 32
+ * bit wide, so a storage holds at most MAX_INDEX + 1 (about 67M) items at
+ * once and running out of indices throws std::length_error. A generation
+ * wraps after 64 reuses of its slot, an ID kept that long after its element
+ * was removed could name a new element again.
+ */
+struct GenerationalId
+{
+    static constexpr uint32_t INDEX_BITS = 26;
+    static constexpr uint32_t INDEX_MASK = (uint32_t{1} << INDEX_BITS) - 1;
+    static constexpr uint32_t GENERATION_MASK = ~INDEX_MASK >> INDEX_BITS;
+    static constexpr uint32_t MAX_INDEX = INDEX_MASK - 1;
+
+    static constexpr uint32_t make(uint32_t index, uint32_t generation)
+    {
+        return ((generation & GENERATION_MASK) << INDEX_BITS) | (index + 1);
+    }
+
+    static constexpr uint32_t index(uint32_t id) { return (id & INDEX_MASK) - 1; }
+    static constexpr uint32_t generation(uint32_t id) { return id >> INDEX_BITS; }
+    static constexpr uint32_t nextGeneration(uint32_t generation) { return (generation + 1) & GENERATION_MASK; }
+};
+
+}  // namespace objects
+}  // namespace mesh
@@ -0,0 +1,129 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+#include "idallocator.hpp"
+
+
+namespace mesh
+{
+namespace objects
+{
+
+template <typename T>
+class HashMap
+{
+    using Map = std::pmr::unordered_map<uint32_t, T>;
+
+public:
+    using iterator = typename Map::iterator;
+    using const_iterator = typename Map::const_iterator;
+
+public:
+    explicit HashMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_items{resource}
+        , m_ids{resource}
+    {}
+
+    HashMap(const HashMap&) = delete;
+    HashMap& operator=(const HashMap&) = delete;
+    HashMap(HashMap&&) = default;
+    HashMap& operator=(HashMap&&) = default;
+
+    uint32_t insert(T value)
+    {
+        const auto id = m_ids.allocate();
+        m_items.insert({id, std::move(value)});
+        return id;
+    }
+
+    bool insert(uint32_t reservedId, T value)
+    {
+        if (!m_ids.claim(reservedId))
+        {
+            return false;
+        }
+        m_items.insert({reservedId, std::move(value)});
+        return true;
+    }
+
+    /** Rebuilds ID allocator around present items, after they were inserted under their own IDs. */
+    void restoreIds()
+    {
+        auto ids = std::vector<uint32_t>{};
+        ids.reserve(m_items.size());
+        for (const auto& item : m_items)
+        {
+            ids.push_back(item.first);
+        }
+        m_ids.restore(ids);
+    }
+
+    std::size_t erase(uint32_t id)
+    {
+        if (m_items.erase(id) == 0)
+        {
+            return 0;
+        }
+        m_ids.release(id);
+        return 1;
+    }
+
+    iterator find(uint32_t id) { return m_items.find(id); }
+    const_iterator find(uint32_t id) const { return m_items.find(id); }
+
+    T& operator[](uint32_t id) { return m_items[id]; }
+
+    iterator begin() { return m_items.begin(); }
+    iterator end() { return m_items.end(); }
+    const_iterator begin() const { return m_items.cbegin(); }
+    const_iterator end() const { return m_items.cend(); }
+    const_iterator cbegin() const { return m_items.cbegin(); }
+    const_iterator cend() const { return m_items.cend(); }
+
+    std::size_t size() const { return m_items.size(); }
+    bool empty() const { return m_items.empty(); }
+    uint32_t indexBound() const { return m_ids.indexBound(); }
+
+    /** Items are split into this many slots (hash buckets) for partitioned scans. */
+    std::size_t slotCount() const { return m_items.bucket_count(); }
+
+    /** Calls function(id, item) for items of given slots, stops when it returns true. */
+    template <typename Function>
+    bool forEachInSlots(std::size_t first, std::size_t last, Function&& function) const
+    {
+        for (auto bucket = first; bucket < last; ++bucket)
+        {
+            for (auto it = m_items.begin(bucket); it != m_items.end(bucket); ++it)
+            {
+                if (function(it->first, it->second))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        for (const auto& item : m_items)
+        {
+            m_ids.release(item.first);
+        }
+        m_items.clear();
+    }
+
+private:
+    Map m_items;
+    IdAllocator m_ids;
+};
+
+}  // namespace objects
+}  // namespace mesh
@@ -0,0 +1,238 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "generationalid.hpp"
+
+
+namespace mesh
+{
+namespace objects
+{
+
+/**
+ * Per-storage ID allocator. Fresh indices are taken with a lock-free
+ * compare-and-swap, released IDs come back through a FIFO free list with
+ * their generation bumped, so one slot wraps its generation only after the
+ * whole free list has been cycled. IDs of items inserted under IDs of
+ * their own are claimed, so they are never handed out again. A claimed ID
+ * stays in the free list until allocate() reaches it, entries no longer
+ * matching their slot's free ID are skipped.
+ */
+class IdAllocator
+{
+public:
+    explicit IdAllocator(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_nextIndex{0}
+        , m_freeCount{0}
+        , m_freeLock{}
+        , m_free{resource}
+        , m_freeIds{resource}
+    {}
+
+    IdAllocator(const IdAllocator&) = delete;
+    IdAllocator& operator=(const IdAllocator&) = delete;
+
+    IdAllocator(IdAllocator&& other) noexcept
+        : m_nextIndex{other.m_nextIndex.load()}
+        , m_freeCount{other.m_freeCount.load()}
+        , m_freeLock{}
+        , m_free{std::move(other.m_free)}
+        , m_freeIds{std::move(other.m_freeIds)}
+    {
+        other.m_nextIndex = 0;
+        other.m_freeCount = 0;
+        other.m_free.clear();
+        other.m_freeIds.clear();
+    }
+
+    IdAllocator& operator=(IdAllocator&& other) noexcept
+    {
+        if (this != &other)
+        {
+            m_nextIndex = other.m_nextIndex.load();
+            m_freeCount = other.m_freeCount.load();
+            m_free = std::move(other.m_free);
+            m_freeIds = std::move(other.m_freeIds);
+            other.m_nextIndex = 0;
+            other.m_freeCount = 0;
+            other.m_free.clear();
+            other.m_freeIds.clear();
+        }
+        return *this;
+    }
+
+    uint32_t allocate()
+    {
+        if (m_freeCount.load(std::memory_order_acquire) != 0)
+        {
+            auto lock = std::lock_guard<std::mutex>{m_freeLock};
+            while (!m_free.empty())
+            {
+                const auto id = m_free.front();
+                m_free.pop_front();
+                if (takeFree(id))
+                {
+                    return id;
+                }
+            }
+        }
+        return GenerationalId::make(freshIndex(), 0);
+    }
+
+    void release(uint32_t id)
+    {
+        const auto index = GenerationalId::index(id);
+        const auto generation = GenerationalId::nextGeneration(GenerationalId::generation(id));
+
+        auto lock = std::lock_guard<std::mutex>{m_freeLock};
+        pushFree(GenerationalId::make(index, generation));
+    }
+
+    /**
+     * Marks ID of an item inserted under it as taken: fresh indices up to
+     * its index are allocated (skipped ones become free) or it is taken out
+     * of the free list. False when its index is live, under any generation.
+     */
+    bool claim(uint32_t id)
+    {
+        if ((id & GenerationalId::INDEX_MASK) == 0)
+        {
+            return false;
+        }
+
+        const auto index = GenerationalId::index(id);
+        auto first = m_nextIndex.load(std::memory_order_relaxed);
+        while (first <= index && !m_nextIndex.compare_exchange_weak(first, index + 1, std::memory_order_acq_rel))
+        {
+        }
+
+        if (first > index)
+        {
+            if (m_freeCount.load(std::memory_order_acquire) == 0)
+            {
+                return false;
+            }
+
+            auto lock = std::lock_guard<std::mutex>{m_freeLock};
+            return index < m_freeIds.size() && m_freeIds[index] != 0 && takeFree(m_freeIds[index]);
+        }
+
+        if (first < index)
+        {
+            auto lock = std::lock_guard<std::mutex>{m_freeLock};
+            for (auto skipped = first; skipped < index; ++skipped)
+            {
+                pushFree(GenerationalId::make(skipped, 0));
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Forgets allocation history after items were inserted under IDs of
+     * their own (restored from a file). Indices below the highest live one
+     * which are not live become free, with generation 0.
+     */
+    template <typename Ids>
+    void restore(const Ids& liveIds)
+    {
+        auto bound = uint32_t{0};
+        for (const auto id : liveIds)
+        {
+            bound = std::max(bound, GenerationalId::index(id) + 1);
+        }
+
+        auto live = std::vector<bool>(bound, false);
+        for (const auto id : liveIds)
+        {
+            live[GenerationalId::index(id)] = true;
+        }
+
+        auto lock = std::lock_guard<std::mutex>{m_freeLock};
+        m_free.clear();
+        m_freeIds.assign(bound, 0);
+        m_freeCount.store(0, std::memory_order_release);
+        for (auto index = 0u; index < bound; ++index)
+        {
+            if (!live[index])
+            {
+                pushFree(GenerationalId::make(index, 0));
+            }
+        }
+        m_nextIndex.store(bound, std::memory_order_release);
+    }
+
+    uint32_t indexBound() const
+    {
+        return m_nextIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    uint32_t freshIndex()
+    {
+        auto first = m_nextIndex.load(std::memory_order_relaxed);
+        do
+        {
+            if (first > GenerationalId::MAX_INDEX)
+            {
+                throw std::length_error{"ID space exhausted, a storage holds at most " +
+                                        std::to_string(GenerationalId::MAX_INDEX + 1) + " items"};
+            }
+        }
+        while (!m_nextIndex.compare_exchange_weak(first, first + 1, std::memory_order_acq_rel));
+        return first;
+    }
+
+    /** Called under m_freeLock. */
+    void pushFree(uint32_t id)
+    {
+        const auto index = GenerationalId::index(id);
+        if (index >= m_freeIds.size())
+        {
+            m_freeIds.resize(index + 1, 0);
+        }
+        m_freeIds[index] = id;
+        m_free.push_back(id);
+        m_freeCount.store(m_freeCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** Called under m_freeLock, false when id is a stale free list entry. */
+    bool takeFree(uint32_t id)
+    {
+        const auto index = GenerationalId::index(id);
+        if (index >= m_freeIds.size() || m_freeIds[index] != id)
+        {
+            return false;
+        }
+
+        m_freeIds[index] = 0;
+        const auto freeCount = m_freeCount.load(std::memory_order_relaxed) - 1;
+        m_freeCount.store(freeCount, std::memory_order_release);
+        if (freeCount == 0)
+        {
+            m_free.clear();
+        }
+        return true;
+    }
+
+private:
+    std::atomic<uint32_t> m_nextIndex;
+    std::atomic<std::size_t> m_freeCount;
+    std::mutex m_freeLock;
+    std::pmr::deque<uint32_t> m_free;
+    std::pmr::vector<uint32_t> m_freeIds;
+};
+
+}  // namespace objects
+}  // namespace mesh
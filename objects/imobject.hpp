@@ -5,8 +5,12 @@
 
 #include <inttypes.h>
 #include <memory>
+#include <memory_resource>
+#include <type_traits>
 #include <unordered_set>
 
+#include "smallset.hpp"
+
 
 namespace mesh
 {
@@ -17,7 +21,8 @@ struct IMObject : public std::enable_shared_from_this<IMObject>
 {
 public:
     using U32Pair = std::pair<uint32_t, uint32_t>;
-    using U32Set = std::unordered_set<uint32_t>;
+    using U32Set = std::pmr::unordered_set<uint32_t>;
+    using U32SmallSet = SmallSet<uint32_t, 4>;
 
 protected:
     explicit IMObject() = default;
@@ -29,5 +34,20 @@ public:
 struct INode : public IMObject {};
 struct IEdge : public IMObject {};
 
+struct LeanObject {};
+
+/**
+ * Nodes and edges are plain wrappers around their description by default.
+ * Specialize to std::true_type to derive them from INode/IEdge instead.
+ */
+template <typename Description>
+struct Polymorphic : std::false_type {};
+
+template <typename Description>
+using NodeBase = std::conditional_t<Polymorphic<Description>::value, INode, LeanObject>;
+
+template <typename Description>
+using EdgeBase = std::conditional_t<Polymorphic<Description>::value, IEdge, LeanObject>;
+
 }  // namespace objects
 }  // namespace mesh
@@ -14,14 +14,16 @@ namespace objects
 {
 
 template <typename Description>
-struct Node : public INode
+struct Node : public NodeBase<Description>
 {
-    using U32Set = IMObject::U32Set;
+    using U32SmallSet = IMObject::U32SmallSet;
 
 public:
     explicit Node() = default;
-    explicit Node(Description description)
-        : m_description{std::move(description)}
+    explicit Node(Description description,
+                  std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_edges{resource}
+        , m_description{std::move(description)}
     {}
 
     Node(const Node&) = delete;
@@ -60,7 +62,7 @@ public:
     }
 
 private:
-    U32Set m_edges;
+    U32SmallSet m_edges;
     Description m_description;
 };
 
@@ -0,0 +1,249 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "generationalid.hpp"
+#include "idallocator.hpp"
+
+
+namespace mesh
+{
+namespace objects
+{
+
+/**
+ * Dense slot map. Values are kept in one contiguous vector (erase moves the
+ * last value into the hole), slots map ID indices to value positions.
+ * Slot indices recycle through IdAllocator with bumped generation, so IDs of
+ * removed elements are rejected even after their slot is reused.
+ */
+template <typename T>
+class SlotMap
+{
+    static constexpr auto NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+    template <bool Const>
+    class Iterator
+    {
+        using Value = std::conditional_t<Const, const T, T>;
+        using Values = std::conditional_t<Const, const std::pmr::vector<T>, std::pmr::vector<T>>;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::pair<const uint32_t, Value&>;
+        using reference = value_type;
+
+        struct pointer
+        {
+            value_type item;
+            const value_type* operator->() const { return &item; }
+        };
+
+    public:
+        explicit Iterator() = default;
+        explicit Iterator(const std::pmr::vector<uint32_t>* ids, Values* values, std::size_t position)
+            : m_ids{ids}
+            , m_values{values}
+            , m_position{position}
+        {}
+
+        template <bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+        Iterator(const Iterator<OtherConst>& other)
+            : m_ids{other.m_ids}
+            , m_values{other.m_values}
+            , m_position{other.m_position}
+        {}
+
+        reference operator*() const { return {(*m_ids)[m_position], (*m_values)[m_position]}; }
+        pointer operator->() const { return {**this}; }
+
+        Iterator& operator++()
+        {
+            ++m_position;
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            auto result = *this;
+            ++m_position;
+            return result;
+        }
+
+        friend bool operator==(const Iterator& lhs, const Iterator& rhs) { return lhs.m_position == rhs.m_position; }
+        friend bool operator!=(const Iterator& lhs, const Iterator& rhs) { return lhs.m_position != rhs.m_position; }
+
+    private:
+        template <bool>
+        friend class Iterator;
+
+        const std::pmr::vector<uint32_t>* m_ids = nullptr;
+        Values* m_values = nullptr;
+        std::size_t m_position = 0;
+    };
+
+public:
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+public:
+    explicit SlotMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_values{resource}
+        , m_valueIds{resource}
+        , m_positions{resource}
+        , m_ids{resource}
+    {}
+
+    SlotMap(const SlotMap&) = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+    SlotMap(SlotMap&&) = default;
+    SlotMap& operator=(SlotMap&&) = default;
+
+    uint32_t insert(T value)
+    {
+        const auto id = m_ids.allocate();
+        place(id, std::move(value));
+        return id;
+    }
+
+    bool insert(uint32_t reservedId, T value)
+    {
+        if (!m_ids.claim(reservedId))
+        {
+            return false;
+        }
+        return place(reservedId, std::move(value));
+    }
+
+    /** Rebuilds ID allocator around present items, after they were inserted under their own IDs. */
+    void restoreIds() { m_ids.restore(m_valueIds); }
+
+    std::size_t erase(uint32_t id)
+    {
+        const auto position = find_position(id);
+        if (position == NO_SLOT)
+        {
+            return 0;
+        }
+
+        const auto lastPosition = static_cast<uint32_t>(m_values.size() - 1);
+        if (position != lastPosition)
+        {
+            m_values[position] = std::move(m_values[lastPosition]);
+            m_valueIds[position] = m_valueIds[lastPosition];
+            m_positions[GenerationalId::index(m_valueIds[position])] = position;
+        }
+        m_values.pop_back();
+        m_valueIds.pop_back();
+
+        m_positions[GenerationalId::index(id)] = NO_SLOT;
+        m_ids.release(id);
+        return 1;
+    }
+
+    iterator find(uint32_t id)
+    {
+        const auto position = find_position(id);
+        return position == NO_SLOT ? end() : iterator{&m_valueIds, &m_values, position};
+    }
+
+    const_iterator find(uint32_t id) const
+    {
+        const auto position = find_position(id);
+        return position == NO_SLOT ? cend() : const_iterator{&m_valueIds, &m_values, position};
+    }
+
+    T& operator[](uint32_t id) { return m_values[find_position(id)]; }
+
+    iterator begin() { return iterator{&m_valueIds, &m_values, 0}; }
+    iterator end() { return iterator{&m_valueIds, &m_values, m_values.size()}; }
+    const_iterator begin() const { return cbegin(); }
+    const_iterator end() const { return cend(); }
+    const_iterator cbegin() const { return const_iterator{&m_valueIds, &m_values, 0}; }
+    const_iterator cend() const { return const_iterator{&m_valueIds, &m_values, m_values.size()}; }
+
+    std::size_t size() const { return m_values.size(); }
+    bool empty() const { return m_values.empty(); }
+    uint32_t indexBound() const { return m_ids.indexBound(); }
+
+    /** Items are split into this many slots (dense positions) for partitioned scans. */
+    std::size_t slotCount() const { return m_values.size(); }
+
+    /** Calls function(id, item) for items of given slots, stops when it returns true. */
+    template <typename Function>
+    bool forEachInSlots(std::size_t first, std::size_t last, Function&& function) const
+    {
+        for (auto position = first; position < last; ++position)
+        {
+            if (function(m_valueIds[position], m_values[position]))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        for (const auto id : m_valueIds)
+        {
+            m_positions[GenerationalId::index(id)] = NO_SLOT;
+            m_ids.release(id);
+        }
+        m_values.clear();
+        m_valueIds.clear();
+    }
+
+private:
+    bool place(uint32_t id, T value)
+    {
+        const auto slotIndex = GenerationalId::index(id);
+        if (slotIndex >= m_positions.size())
+        {
+            m_positions.resize(slotIndex + 1, NO_SLOT);
+        }
+        else if (m_positions[slotIndex] != NO_SLOT)
+        {
+            return false;
+        }
+
+        m_positions[slotIndex] = static_cast<uint32_t>(m_values.size());
+        m_values.push_back(std::move(value));
+        m_valueIds.push_back(id);
+        return true;
+    }
+
+    uint32_t find_position(uint32_t id) const
+    {
+        const auto slotIndex = GenerationalId::index(id);
+        if (id == 0 || slotIndex >= m_positions.size())
+        {
+            return NO_SLOT;
+        }
+
+        const auto position = m_positions[slotIndex];
+        if (position == NO_SLOT || m_valueIds[position] != id)
+        {
+            return NO_SLOT;
+        }
+        return position;
+    }
+
+private:
+    std::pmr::vector<T> m_values;
+    std::pmr::vector<uint32_t> m_valueIds;
+    std::pmr::vector<uint32_t> m_positions;
+    IdAllocator m_ids;
+};
+
+}  // namespace objects
+}  // namespace mesh
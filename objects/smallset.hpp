@@ -0,0 +1,221 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <inttypes.h>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+
+namespace mesh
+{
+namespace objects
+{
+
+/**
+ * Sorted set of trivially copyable values. Up to Capacity values are kept
+ * inline in the object, above that values spill to a buffer taken from
+ * the memory resource.
+ */
+template <typename T, uint32_t Capacity>
+class SmallSet
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SmallSet keeps only trivially copyable values");
+    static_assert(Capacity > 0, "SmallSet needs inline capacity");
+
+public:
+    using value_type = T;
+    using iterator = const T*;
+    using const_iterator = const T*;
+
+public:
+    explicit SmallSet(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_resource{resource}
+        , m_size{0}
+        , m_capacity{Capacity}
+    {}
+
+    SmallSet(const SmallSet& other)
+        : m_resource{std::pmr::get_default_resource()}
+        , m_size{0}
+        , m_capacity{Capacity}
+    {
+        assign(other);
+    }
+
+    SmallSet(const SmallSet& other, std::pmr::memory_resource* resource)
+        : m_resource{resource}
+        , m_size{0}
+        , m_capacity{Capacity}
+    {
+        assign(other);
+    }
+
+    SmallSet(SmallSet&& other) noexcept
+        : m_resource{other.m_resource}
+        , m_size{0}
+        , m_capacity{Capacity}
+    {
+        steal(other);
+    }
+
+    SmallSet& operator=(const SmallSet& other)
+    {
+        if (this != &other)
+        {
+            m_size = 0;
+            assign(other);
+        }
+        return *this;
+    }
+
+    SmallSet& operator=(SmallSet&& other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+        else if (m_resource->is_equal(*other.m_resource))
+        {
+            release();
+            steal(other);
+        }
+        else
+        {
+            m_size = 0;
+            assign(other);
+            other.m_size = 0;
+        }
+        return *this;
+    }
+
+    ~SmallSet()
+    {
+        release();
+    }
+
+    std::pair<iterator, bool> insert(T value)
+    {
+        auto position = lower_bound(value);
+        if (position != end() && *position == value)
+        {
+            return {position, false};
+        }
+
+        const auto index = static_cast<uint32_t>(position - begin());
+        if (m_size == m_capacity)
+        {
+            grow(m_capacity * 2);
+        }
+
+        auto* items = data();
+        std::memmove(items + index + 1, items + index, (m_size - index) * sizeof(T));
+        items[index] = value;
+        ++m_size;
+        return {items + index, true};
+    }
+
+    std::size_t erase(T value)
+    {
+        const auto position = find(value);
+        if (position == end())
+        {
+            return 0;
+        }
+
+        const auto index = static_cast<uint32_t>(position - begin());
+        auto* items = data();
+        std::memmove(items + index, items + index + 1, (m_size - index - 1) * sizeof(T));
+        --m_size;
+        return 1;
+    }
+
+    const_iterator find(T value) const
+    {
+        const auto position = lower_bound(value);
+        return (position != end() && *position == value) ? position : end();
+    }
+
+    std::size_t count(T value) const { return find(value) != end() ? 1 : 0; }
+
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + m_size; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    void clear() { m_size = 0; }
+
+private:
+    bool isInline() const { return m_capacity == Capacity; }
+    T* data() { return isInline() ? m_inline : m_heap; }
+    const T* data() const { return isInline() ? m_inline : m_heap; }
+
+    const T* lower_bound(T value) const
+    {
+        return std::lower_bound(begin(), end(), value);
+    }
+
+    void grow(uint32_t capacity)
+    {
+        auto* heap = static_cast<T*>(m_resource->allocate(capacity * sizeof(T), alignof(T)));
+        std::memcpy(heap, data(), m_size * sizeof(T));
+        release();
+        m_heap = heap;
+        m_capacity = capacity;
+    }
+
+    void assign(const SmallSet& other)
+    {
+        if (other.m_size > m_capacity)
+        {
+            grow(other.m_capacity);
+        }
+        std::memcpy(data(), other.data(), other.m_size * sizeof(T));
+        m_size = other.m_size;
+    }
+
+    void steal(SmallSet& other)
+    {
+        if (other.isInline())
+        {
+            std::memcpy(m_inline, other.m_inline, other.m_size * sizeof(T));
+            m_capacity = Capacity;
+        }
+        else
+        {
+            m_heap = other.m_heap;
+            m_capacity = other.m_capacity;
+            other.m_capacity = Capacity;
+        }
+        m_size = other.m_size;
+        other.m_size = 0;
+    }
+
+    void release()
+    {
+        if (!isInline())
+        {
+            m_resource->deallocate(m_heap, m_capacity * sizeof(T), alignof(T));
+            m_capacity = Capacity;
+        }
+    }
+
+private:
+    std::pmr::memory_resource* m_resource;
+    uint32_t m_size;
+    uint32_t m_capacity;
+    union
+    {
+        T m_inline[Capacity];
+        T* m_heap;
+    };
+};
+
+}  // namespace objects
+}  // namespace mesh
@@ -3,11 +3,15 @@
  */
 #pragma once
 
-#include <unordered_map>
+#include <memory_resource>
 #include <queue>
+#include <unordered_map>
+#include <vector>
 
-#include "node.hpp"
 #include "edge.hpp"
+#include "hashmap.hpp"
+#include "node.hpp"
+#include "slotmap.hpp"
 
 
 namespace mesh
@@ -17,18 +21,33 @@ namespace objects
 namespace types
 {
 
-using U32PairMap = std::unordered_map<uint32_t, uint32_t>;
+struct HashStorage
+{
+    template <typename T>
+    using Map = HashMap<T>;
+};
+
+struct SlotStorage
+{
+    template <typename T>
+    using Map = SlotMap<T>;
+};
+
+using U32PairMap = std::pmr::unordered_map<uint32_t, uint32_t>;
 
-template <typename Description>
-using U32EdgeMap = std::unordered_map<uint32_t, Edge<Description>>;
+template <typename Description, typename Storage = HashStorage>
+using U32EdgeMap = typename Storage::template Map<Edge<Description>>;
 
-template <typename Description>
-using U32NodeMap = std::unordered_map<uint32_t, Node<Description>>;
+template <typename Description, typename Storage = HashStorage>
+using U32NodeMap = typename Storage::template Map<Node<Description>>;
 
 using U32Pair = IMObject::U32Pair;
-using U32U32Map = std::unordered_map<uint32_t, uint32_t>;
-using U32PairPriorityQueue = std::priority_queue<U32Pair, std::vector<U32Pair>, std::greater<U32Pair>>;
+using U32U32Map = std::pmr::unordered_map<uint32_t, uint32_t>;
+using U32PairPriorityQueue = std::priority_queue<U32Pair, std::pmr::vector<U32Pair>, std::greater<U32Pair>>;
 using U32Set = IMObject::U32Set;
+using U32SmallSet = IMObject::U32SmallSet;
+using U32Vector = std::pmr::vector<uint32_t>;
+using U64U32Map = std::pmr::unordered_map<uint64_t, uint32_t>;
 
 }  // namespace types
 }  // namespace objects
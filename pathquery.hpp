@@ -0,0 +1,160 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory_resource>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mesh.hpp"
+#include "utils/pathsearch.hpp"
+#include "utils/threadpool.hpp"
+
+
+namespace mesh
+{
+
+/**
+ * Answers batches of path queries in parallel against a mesh that is not
+ * modified meanwhile. Every worker keeps its own path search scratch, so
+ * after the first batch queries allocate only their results. The scratch
+ * grows on worker threads, so it uses the new/delete resource rather than
+ * the mesh one.
+ */
+template <typename NodeDescription,
+          typename EdgeDescription = NodeDescription,
+          typename Storage = objects::types::HashStorage>
+class PathQuery
+{
+    using MeshType = Mesh<NodeDescription, EdgeDescription, Storage>;
+
+    static constexpr std::size_t CHUNK = 64;
+
+public:
+    using NodePredicate = std::function<bool(const objects::Node<NodeDescription>&)>;
+    using Query = std::pair<uint32_t, uint32_t>;
+    using PredicateQuery = std::pair<NodePredicate, NodePredicate>;
+    using Paths = std::vector<std::vector<uint32_t>>;
+
+public:
+    explicit PathQuery(const MeshType& mesh, unsigned threads = std::thread::hardware_concurrency())
+        : m_mesh{mesh}
+        , m_pool{threads}
+        , m_searches{}
+    {
+        m_searches.reserve(m_pool.size());
+        for (auto i = 0u; i < m_pool.size(); ++i)
+        {
+            m_searches.emplace_back(std::pmr::new_delete_resource());
+        }
+    }
+
+    Paths pathsBetween(const std::vector<Query>& queries)
+    {
+        auto paths = Paths{};
+        pathsBetween(queries, paths);
+        return paths;
+    }
+
+    /** Same as above, but reuses capacity of given paths. */
+    void pathsBetween(const std::vector<Query>& queries, Paths& paths)
+    {
+        paths.resize(queries.size());
+        forEachQuery(queries.size(), [&](utils::PathSearch& search, std::size_t i)
+        {
+            pathBetween(search, queries[i].first, queries[i].second, paths[i]);
+        });
+    }
+
+    Paths pathsBetween(const std::vector<PredicateQuery>& queries)
+    {
+        auto paths = Paths{};
+        pathsBetween(queries, paths);
+        return paths;
+    }
+
+    void pathsBetween(const std::vector<PredicateQuery>& queries, Paths& paths)
+    {
+        paths.resize(queries.size());
+        forEachQuery(queries.size(), [&](utils::PathSearch& search, std::size_t i)
+        {
+            pathBetween(search, queries[i].first, queries[i].second, paths[i]);
+        });
+    }
+
+private:
+    template <typename Function>
+    void forEachQuery(std::size_t count, Function&& function)
+    {
+        auto next = std::atomic<std::size_t>{0};
+        m_pool.run([&](unsigned worker)
+        {
+            auto& search = m_searches[worker];
+            for (auto first = next.fetch_add(CHUNK); first < count; first = next.fetch_add(CHUNK))
+            {
+                const auto last = std::min(count, first + CHUNK);
+                for (auto i = first; i < last; ++i)
+                {
+                    function(search, i);
+                }
+            }
+        });
+    }
+
+    void pathBetween(utils::PathSearch& search, uint32_t begin, uint32_t end, std::vector<uint32_t>& path) const
+    {
+        const auto& nodes = m_mesh.m_nodes;
+        path.clear();
+        if (begin == end)
+        {
+            path.push_back(begin);
+        }
+        else if (nodes.find(begin) != nodes.end() && nodes.find(end) != nodes.end())
+        {
+            search.shortestPath(typename MeshType::Adjacency{m_mesh}, begin, end, path);
+        }
+    }
+
+    void pathBetween(utils::PathSearch& search,
+                     const NodePredicate& begin,
+                     const NodePredicate& end,
+                     std::vector<uint32_t>& path) const
+    {
+        const auto& nodes = m_mesh.m_nodes;
+        path.clear();
+
+        const auto beginIt = std::find_if(nodes.cbegin(), nodes.cend(), [&begin](const auto& item) { return begin(item.second); });
+        if (beginIt == nodes.cend())
+        {
+            return;
+        }
+
+        const auto beginNodeId = beginIt->first;
+        const auto endIt = std::find_if(nodes.cbegin(), nodes.cend(), [&beginNodeId, &end](const auto& item)
+        {
+            return (beginNodeId != item.first) && end(item.second);
+        });
+        if (endIt == nodes.cend())
+        {
+            if (end(beginIt->second))
+            {
+                path.push_back(beginNodeId);
+            }
+            return;
+        }
+
+        pathBetween(search, beginNodeId, endIt->first, path);
+    }
+
+private:
+    const MeshType& m_mesh;
+    utils::ThreadPool m_pool;
+    std::vector<utils::PathSearch> m_searches;
+};
+
+}  // namespace mesh
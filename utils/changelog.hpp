@@ -0,0 +1,40 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <inttypes.h>
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Receiver of every change of a mesh, reported as its effect on single
+ * nodes and edges after it is done. Mesh keeps it behind this interface, so
+ * change logging (see Journal) costs a pointer check while it is off.
+ */
+template <typename NodeDescription, typename EdgeDescription>
+class IChangeLog
+{
+public:
+    virtual ~IChangeLog() = default;
+
+    virtual void insertNode(uint32_t nodeId, const NodeDescription& description) = 0;
+    virtual void insertEdge(uint32_t edgeId, uint32_t firstNodeId, uint32_t secondNodeId,
+                            const EdgeDescription& description) = 0;
+
+    /** Edges of the node are reported erased before it. */
+    virtual void eraseNode(uint32_t nodeId) = 0;
+    virtual void eraseEdge(uint32_t edgeId) = 0;
+    virtual void edit(uint32_t nodeId, const NodeDescription& description) = 0;
+    virtual void clear() = 0;
+
+    /** Ends a public change of the mesh, changes reported so far leave it consistent. */
+    virtual void operationEnd() = 0;
+};
+
+}  // namespace utils
+}  // namespace mesh
@@ -0,0 +1,99 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <cstring>
+#include <inttypes.h>
+#include <string>
+#include <type_traits>
+
+#include "utils/packformat.hpp"
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Compact binary mesh file, version 3 of the pack format. Nodes are
+ * renumbered densely in ID order, descriptions of nodes and edges share a
+ * dictionary (most frequent first) and all numbers are LEB128 varints:
+ *     CompactHeader
+ *     uint64_t[blocks]             end offset of every block in data
+ *     data                         word blocks, node blocks, edge blocks
+ * Every stream is cut into blocks of blockSize elements, which decode on
+ * their own:
+ *     word                         varint length, bytes
+ *     node                         varint word index
+ *     edge                         varint delta of the lower endpoint index,
+ *                                  varint higher minus lower endpoint index,
+ *                                  varint word index
+ * Edges are sorted by endpoints, deltas start from 0 in every block. The
+ * checksum covers everything after the header.
+ */
+struct CompactHeader
+{
+    static constexpr uint32_t VERSION = 3;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t nodeCount;
+    uint64_t edgeCount;
+    uint64_t wordCount;
+    uint32_t blockSize;
+    uint32_t reserved;
+    uint64_t dataSize;
+    uint64_t checksum;
+
+    bool valid() const
+    {
+        return std::memcmp(magic, PackHeader::MAGIC, sizeof(PackHeader::MAGIC)) == 0 &&
+               version == VERSION &&
+               headerSize == sizeof(CompactHeader) &&
+               blockSize != 0;
+    }
+
+    static uint64_t blocks(uint64_t count, uint32_t blockSize) { return (count + blockSize - 1) / blockSize; }
+
+    uint64_t wordBlocks() const { return blocks(wordCount, blockSize); }
+    uint64_t nodeBlocks() const { return blocks(nodeCount, blockSize); }
+    uint64_t edgeBlocks() const { return blocks(edgeCount, blockSize); }
+};
+
+static_assert(sizeof(CompactHeader) == 64 && std::is_trivially_copyable_v<CompactHeader>);
+
+inline void putVarint(std::string& output, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        output.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+/** Reads a varint at cursor and moves it past, false when data ends or the value does not fit 64 bits. */
+inline bool getVarint(const char*& cursor, const char* end, uint64_t& value)
+{
+    value = 0;
+    for (auto shift = 0u; shift < 64 && cursor != end; shift += 7)
+    {
+        const auto byte = static_cast<unsigned char>(*cursor++);
+        if (shift == 63 && (byte & 0x7Eu) != 0)
+        {
+            return false;
+        }
+        value |= uint64_t{byte & 0x7Fu} << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace utils
+}  // namespace mesh
@@ -0,0 +1,571 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <limits>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Fully dynamic connectivity (Holm, de Lichtenberg, Thorup). Every edge has
+ * a level, F_i is a spanning forest of tree edges with level >= i kept as
+ * Euler tours in treaps. Removing a tree edge searches replacement on the
+ * smaller side only, promoting every edge it has checked one level up, which
+ * gives O(log^2 n) amortized updates and O(log n) connectivity and component
+ * size queries. Vertices and edges are addressed by dense indices.
+ */
+class DynamicConnectivity
+{
+    static constexpr auto NIL = std::numeric_limits<uint32_t>::max();
+
+    static constexpr uint8_t VERTEX = 1;
+    static constexpr uint8_t NON_TREE = 2;
+    static constexpr uint8_t LEVEL_TREE = 4;
+
+    struct TourNode
+    {
+        uint32_t left;
+        uint32_t right;
+        uint32_t parent;
+        uint32_t priority;
+        uint32_t count;
+        uint32_t vertices;
+        uint32_t payload;
+        uint8_t flags;
+        uint8_t subtreeFlags;
+    };
+
+    struct EdgeInfo
+    {
+        uint32_t first = NIL;
+        uint32_t second = NIL;
+        uint32_t firstPosition = NIL;
+        uint32_t secondPosition = NIL;
+        uint32_t level = 0;
+        bool tree = false;
+        bool alive = false;
+    };
+
+    struct Level
+    {
+        explicit Level(std::pmr::memory_resource* resource)
+            : vertexNodes{resource}
+            , arcs{resource}
+            , nonTree{resource}
+        {}
+
+        std::pmr::vector<uint32_t> vertexNodes;
+        std::pmr::vector<std::pair<uint32_t, uint32_t>> arcs;
+        std::pmr::vector<std::pmr::vector<uint32_t>> nonTree;
+    };
+
+public:
+    explicit DynamicConnectivity(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_resource{resource}
+        , m_nodes{resource}
+        , m_freeNodes{resource}
+        , m_edges{resource}
+        , m_levels{resource}
+        , m_seed{0x9E3779B9u}
+    {
+        m_levels.emplace_back(m_resource);
+    }
+
+    void insertEdge(uint32_t edge, uint32_t first, uint32_t second)
+    {
+        if (edge >= m_edges.size())
+        {
+            m_edges.resize(edge + 1);
+        }
+
+        auto& info = m_edges[edge];
+        info = EdgeInfo{};
+        info.first = first;
+        info.second = second;
+        info.alive = true;
+
+        if (!connected(first, second))
+        {
+            info.tree = true;
+            link(0, edge);
+        }
+        else
+        {
+            addNonTree(0, edge);
+        }
+    }
+
+    void eraseEdge(uint32_t edge)
+    {
+        if (edge >= m_edges.size() || !m_edges[edge].alive)
+        {
+            return;
+        }
+
+        auto& info = m_edges[edge];
+        info.alive = false;
+        if (!info.tree)
+        {
+            removeNonTree(info.level, edge);
+            return;
+        }
+
+        for (auto level = 0u; level <= info.level; ++level)
+        {
+            cut(level, edge);
+        }
+        replace(info.first, info.second, info.level);
+    }
+
+    void eraseVertex(uint32_t vertex)
+    {
+        for (auto& level : m_levels)
+        {
+            if (vertex < level.vertexNodes.size() && level.vertexNodes[vertex] != NIL)
+            {
+                freeNode(level.vertexNodes[vertex]);
+                level.vertexNodes[vertex] = NIL;
+            }
+        }
+    }
+
+    /**
+     * Drops whole connected components at once, without searching
+     * replacements for their tree edges.
+     */
+    template <typename VertexRange, typename EdgeRange>
+    void eraseComponent(const VertexRange& vertices, const EdgeRange& edges)
+    {
+        for (const auto edge : edges)
+        {
+            if (edge >= m_edges.size() || !m_edges[edge].alive)
+            {
+                continue;
+            }
+
+            auto& info = m_edges[edge];
+            info.alive = false;
+            if (info.tree)
+            {
+                for (auto level = 0u; level <= info.level; ++level)
+                {
+                    auto& arcs = m_levels[level].arcs[edge];
+                    freeNode(arcs.first);
+                    freeNode(arcs.second);
+                    arcs = {NIL, NIL};
+                }
+            }
+        }
+
+        for (const auto vertex : vertices)
+        {
+            for (auto& level : m_levels)
+            {
+                if (vertex < level.nonTree.size())
+                {
+                    level.nonTree[vertex].clear();
+                }
+            }
+            eraseVertex(vertex);
+        }
+    }
+
+    bool connected(uint32_t first, uint32_t second) const
+    {
+        return first == second || component(first) == component(second);
+    }
+
+    uint64_t component(uint32_t vertex) const
+    {
+        const auto node = vertexNode(0, vertex);
+        return node == NIL ? ((uint64_t{1} << 32) | vertex) : root(node);
+    }
+
+    uint32_t componentSize(uint32_t vertex) const
+    {
+        const auto node = vertexNode(0, vertex);
+        return node == NIL ? 1 : m_nodes[root(node)].vertices;
+    }
+
+    void clear()
+    {
+        m_nodes.clear();
+        m_freeNodes.clear();
+        m_edges.clear();
+        m_levels.clear();
+        m_levels.emplace_back(m_resource);
+    }
+
+private:
+    void replace(uint32_t first, uint32_t second, uint32_t edgeLevel)
+    {
+        for (auto level = edgeLevel + 1; level-- > 0; )
+        {
+            const auto firstNode = vertexNode(level, first);
+            const auto secondNode = vertexNode(level, second);
+            const auto firstSize = firstNode == NIL ? 1 : m_nodes[root(firstNode)].vertices;
+            const auto secondSize = secondNode == NIL ? 1 : m_nodes[root(secondNode)].vertices;
+            const auto smallNode = firstSize <= secondSize ? firstNode : secondNode;
+            if (smallNode == NIL)
+            {
+                continue;
+            }
+
+            promoteTreeEdges(level, smallNode);
+            if (reconnect(level, smallNode))
+            {
+                return;
+            }
+        }
+    }
+
+    void promoteTreeEdges(uint32_t level, uint32_t treeNode)
+    {
+        while (m_nodes[root(treeNode)].subtreeFlags & LEVEL_TREE)
+        {
+            const auto arc = findFlagged(root(treeNode), LEVEL_TREE);
+            const auto edge = m_nodes[arc].payload;
+            setFlag(arc, LEVEL_TREE, false);
+            m_edges[edge].level = level + 1;
+            link(level + 1, edge);
+        }
+    }
+
+    bool reconnect(uint32_t level, uint32_t treeNode)
+    {
+        while (m_nodes[root(treeNode)].subtreeFlags & NON_TREE)
+        {
+            const auto vertexNodeId = findFlagged(root(treeNode), NON_TREE);
+            const auto vertex = m_nodes[vertexNodeId].payload;
+            ensureLevel(level + 1);
+
+            while (!m_levels[level].nonTree[vertex].empty())
+            {
+                const auto edge = m_levels[level].nonTree[vertex].back();
+                const auto& info = m_edges[edge];
+                const auto other = info.first == vertex ? info.second : info.first;
+                const auto otherNode = vertexNode(level, other);
+                removeNonTree(level, edge);
+
+                if (otherNode != NIL && root(otherNode) == root(treeNode))
+                {
+                    m_edges[edge].level = level + 1;
+                    addNonTree(level + 1, edge);
+                }
+                else
+                {
+                    m_edges[edge].tree = true;
+                    for (auto treeLevel = 0u; treeLevel <= level; ++treeLevel)
+                    {
+                        link(treeLevel, edge);
+                    }
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void link(uint32_t level, uint32_t edge)
+    {
+        ensureLevel(level);
+        const auto& info = m_edges[edge];
+        const auto firstTree = reroot(ensureVertexNode(level, info.first));
+        const auto secondTree = reroot(ensureVertexNode(level, info.second));
+
+        const auto firstArc = newNode(edge, info.level == level ? LEVEL_TREE : 0);
+        const auto secondArc = newNode(edge, 0);
+        auto& arcs = m_levels[level].arcs;
+        if (edge >= arcs.size())
+        {
+            arcs.resize(edge + 1, {NIL, NIL});
+        }
+        arcs[edge] = {firstArc, secondArc};
+
+        merge(merge(merge(firstTree, firstArc), secondTree), secondArc);
+    }
+
+    void cut(uint32_t level, uint32_t edge)
+    {
+        auto [firstArc, secondArc] = m_levels[level].arcs[edge];
+        m_levels[level].arcs[edge] = {NIL, NIL};
+
+        auto firstPosition = position(firstArc);
+        auto secondPosition = position(secondArc);
+        if (firstPosition > secondPosition)
+        {
+            std::swap(firstArc, secondArc);
+            std::swap(firstPosition, secondPosition);
+        }
+
+        const auto [before, fromFirst] = split(root(firstArc), firstPosition);
+        const auto [firstAlone, afterFirst] = split(fromFirst, 1);
+        const auto [inner, fromSecond] = split(afterFirst, secondPosition - firstPosition - 1);
+        const auto [secondAlone, after] = split(fromSecond, 1);
+        merge(before, after);
+
+        (void)firstAlone;
+        (void)secondAlone;
+        (void)inner;
+        freeNode(firstArc);
+        freeNode(secondArc);
+    }
+
+    uint32_t reroot(uint32_t node)
+    {
+        const auto [before, after] = split(root(node), position(node));
+        return merge(after, before);
+    }
+
+    void addNonTree(uint32_t level, uint32_t edge)
+    {
+        ensureLevel(level);
+        auto& info = m_edges[edge];
+        info.firstPosition = pushNonTree(level, info.first, edge);
+        info.secondPosition = pushNonTree(level, info.second, edge);
+    }
+
+    uint32_t pushNonTree(uint32_t level, uint32_t vertex, uint32_t edge)
+    {
+        auto& nonTree = m_levels[level].nonTree;
+        if (vertex >= nonTree.size())
+        {
+            nonTree.resize(vertex + 1);
+        }
+
+        auto& edges = nonTree[vertex];
+        edges.push_back(edge);
+        if (edges.size() == 1)
+        {
+            setFlag(ensureVertexNode(level, vertex), NON_TREE, true);
+        }
+        return static_cast<uint32_t>(edges.size() - 1);
+    }
+
+    void removeNonTree(uint32_t level, uint32_t edge)
+    {
+        const auto& info = m_edges[edge];
+        popNonTree(level, info.first, info.firstPosition);
+        popNonTree(level, info.second, info.secondPosition);
+    }
+
+    void popNonTree(uint32_t level, uint32_t vertex, uint32_t position)
+    {
+        auto& edges = m_levels[level].nonTree[vertex];
+        const auto moved = edges.back();
+        edges[position] = moved;
+        edges.pop_back();
+
+        if (position < edges.size())
+        {
+            auto& movedInfo = m_edges[moved];
+            if (movedInfo.first == vertex)
+            {
+                movedInfo.firstPosition = position;
+            }
+            else
+            {
+                movedInfo.secondPosition = position;
+            }
+        }
+
+        if (edges.empty())
+        {
+            setFlag(vertexNode(level, vertex), NON_TREE, false);
+        }
+    }
+
+    void ensureLevel(uint32_t level)
+    {
+        while (m_levels.size() <= level)
+        {
+            m_levels.emplace_back(m_resource);
+        }
+    }
+
+    uint32_t vertexNode(uint32_t level, uint32_t vertex) const
+    {
+        if (level >= m_levels.size() || vertex >= m_levels[level].vertexNodes.size())
+        {
+            return NIL;
+        }
+        return m_levels[level].vertexNodes[vertex];
+    }
+
+    uint32_t ensureVertexNode(uint32_t level, uint32_t vertex)
+    {
+        auto& vertexNodes = m_levels[level].vertexNodes;
+        if (vertex >= vertexNodes.size())
+        {
+            vertexNodes.resize(vertex + 1, NIL);
+        }
+
+        if (vertexNodes[vertex] == NIL)
+        {
+            const auto node = newNode(vertex, VERTEX);
+            vertexNodes[vertex] = node;
+        }
+        return vertexNodes[vertex];
+    }
+
+    uint32_t newNode(uint32_t payload, uint8_t flags)
+    {
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 17;
+        m_seed ^= m_seed << 5;
+        const auto node = TourNode{NIL, NIL, NIL, m_seed, 1, (flags & VERTEX) ? 1u : 0u, payload, flags, flags};
+
+        if (!m_freeNodes.empty())
+        {
+            const auto index = m_freeNodes.back();
+            m_freeNodes.pop_back();
+            m_nodes[index] = node;
+            return index;
+        }
+        m_nodes.push_back(node);
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+
+    void freeNode(uint32_t node)
+    {
+        m_freeNodes.push_back(node);
+    }
+
+    uint32_t count(uint32_t node) const { return node == NIL ? 0 : m_nodes[node].count; }
+    uint32_t vertices(uint32_t node) const { return node == NIL ? 0 : m_nodes[node].vertices; }
+    uint8_t subtreeFlags(uint32_t node) const { return node == NIL ? 0 : m_nodes[node].subtreeFlags; }
+
+    void update(uint32_t node)
+    {
+        auto& item = m_nodes[node];
+        item.count = 1 + count(item.left) + count(item.right);
+        item.vertices = ((item.flags & VERTEX) ? 1 : 0) + vertices(item.left) + vertices(item.right);
+        item.subtreeFlags = item.flags | subtreeFlags(item.left) | subtreeFlags(item.right);
+    }
+
+    void setFlag(uint32_t node, uint8_t flag, bool enabled)
+    {
+        auto& item = m_nodes[node];
+        item.flags = enabled ? (item.flags | flag) : (item.flags & ~flag);
+        for (auto current = node; current != NIL; current = m_nodes[current].parent)
+        {
+            update(current);
+        }
+    }
+
+    uint32_t root(uint32_t node) const
+    {
+        while (m_nodes[node].parent != NIL)
+        {
+            node = m_nodes[node].parent;
+        }
+        return node;
+    }
+
+    uint32_t position(uint32_t node) const
+    {
+        auto result = count(m_nodes[node].left);
+        for (auto parent = m_nodes[node].parent; parent != NIL; node = parent, parent = m_nodes[node].parent)
+        {
+            if (m_nodes[parent].right == node)
+            {
+                result += count(m_nodes[parent].left) + 1;
+            }
+        }
+        return result;
+    }
+
+    uint32_t findFlagged(uint32_t node, uint8_t flag) const
+    {
+        while (!(m_nodes[node].flags & flag))
+        {
+            const auto left = m_nodes[node].left;
+            node = (subtreeFlags(left) & flag) ? left : m_nodes[node].right;
+        }
+        return node;
+    }
+
+    uint32_t merge(uint32_t left, uint32_t right)
+    {
+        if (left == NIL)
+        {
+            return right;
+        }
+        else if (right == NIL)
+        {
+            return left;
+        }
+
+        if (m_nodes[left].priority > m_nodes[right].priority)
+        {
+            const auto merged = merge(m_nodes[left].right, right);
+            m_nodes[left].right = merged;
+            m_nodes[merged].parent = left;
+            m_nodes[left].parent = NIL;
+            update(left);
+            return left;
+        }
+        else
+        {
+            const auto merged = merge(left, m_nodes[right].left);
+            m_nodes[right].left = merged;
+            m_nodes[merged].parent = right;
+            m_nodes[right].parent = NIL;
+            update(right);
+            return right;
+        }
+    }
+
+    std::pair<uint32_t, uint32_t> split(uint32_t node, uint32_t leftCount)
+    {
+        if (node == NIL)
+        {
+            return {NIL, NIL};
+        }
+
+        m_nodes[node].parent = NIL;
+        const auto left = m_nodes[node].left;
+        if (leftCount <= count(left))
+        {
+            const auto [first, second] = split(left, leftCount);
+            m_nodes[node].left = second;
+            if (second != NIL)
+            {
+                m_nodes[second].parent = node;
+            }
+            update(node);
+            return {first, node};
+        }
+        else
+        {
+            const auto [first, second] = split(m_nodes[node].right, leftCount - count(left) - 1);
+            m_nodes[node].right = first;
+            if (first != NIL)
+            {
+                m_nodes[first].parent = node;
+            }
+            update(node);
+            return {node, second};
+        }
+    }
+
+private:
+    std::pmr::memory_resource* m_resource;
+    std::pmr::vector<TourNode> m_nodes;
+    std::pmr::vector<uint32_t> m_freeNodes;
+    std::pmr::vector<EdgeInfo> m_edges;
+    std::pmr::vector<Level> m_levels;
+    uint32_t m_seed;
+};
+
+}  // namespace utils
+}  // namespace mesh
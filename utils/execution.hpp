@@ -0,0 +1,111 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+#include "utils/threadpool.hpp"
+
+
+namespace mesh
+{
+namespace execution
+{
+
+/**
+ * Execution policies of Mesh scans. Parallel ones split the node or edge
+ * storage into contiguous parts scanned on separate threads, so callables
+ * have to be safe to run concurrently. par_unseq additionally allows calls
+ * on one thread to be interleaved, currently it runs the same as par.
+ */
+struct SequencedPolicy {};
+struct ParallelPolicy {};
+struct ParallelUnsequencedPolicy {};
+
+inline constexpr SequencedPolicy seq{};
+inline constexpr ParallelPolicy par{};
+inline constexpr ParallelUnsequencedPolicy par_unseq{};
+
+template <typename T>
+struct IsExecutionPolicy : std::false_type {};
+
+template <>
+struct IsExecutionPolicy<SequencedPolicy> : std::true_type {};
+
+template <>
+struct IsExecutionPolicy<ParallelPolicy> : std::true_type {};
+
+template <>
+struct IsExecutionPolicy<ParallelUnsequencedPolicy> : std::true_type {};
+
+template <typename T>
+inline constexpr bool isExecutionPolicy = IsExecutionPolicy<std::decay_t<T>>::value;
+
+}  // namespace execution
+
+namespace utils
+{
+
+/** Number of parts a scan of count items is split into under given policy. */
+template <typename Policy>
+std::size_t partCount(Policy, std::size_t count)
+{
+    constexpr auto GRAIN = std::size_t{4096};
+
+    if constexpr (std::is_same_v<std::decay_t<Policy>, execution::SequencedPolicy>)
+    {
+        return 1;
+    }
+    else
+    {
+        return std::clamp<std::size_t>(count / GRAIN, 1, sharedPool().size());
+    }
+}
+
+/**
+ * Calls function(part, first, last) on parts consecutive ranges of [0, count)
+ * on the workers of the shared pool, the calling thread included. Parts run
+ * one after another on the calling thread when the pool is busy, also when
+ * called from inside a part. The first exception thrown is rethrown once the
+ * parts being run are done.
+ */
+template <typename Function>
+void forEachPart(std::size_t parts, std::size_t count, Function&& function)
+{
+    if (parts <= 1)
+    {
+        function(std::size_t{0}, std::size_t{0}, count);
+        return;
+    }
+
+    const auto chunk = (count + parts - 1) / parts;
+    const auto runPart = [&function, chunk, count](std::size_t part)
+    {
+        const auto first = std::min(count, part * chunk);
+        function(part, first, std::min(count, first + chunk));
+    };
+
+    auto nextPart = std::atomic<std::size_t>{0};
+    const auto ran = sharedPool().tryRun([&runPart, &nextPart, parts](unsigned)
+    {
+        for (auto part = nextPart++; part < parts; part = nextPart++)
+        {
+            runPart(part);
+        }
+    });
+
+    if (!ran)
+    {
+        for (auto part = std::size_t{0}; part < parts; ++part)
+        {
+            runPart(part);
+        }
+    }
+}
+
+}  // namespace utils
+}  // namespace mesh
@@ -0,0 +1,103 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <inttypes.h>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Reusable breadth first expansion limited to a number of hops. Visited
+ * marks are an array indexed by dense vertex index and stamped with the
+ * query number, the result list itself serves as the frontier, so a query
+ * touches only the vertices it returns and their edges. Graph is the same
+ * adapter as for ParallelBfs.
+ */
+class HopSearch
+{
+public:
+    using Reached = std::vector<std::pair<uint32_t, uint32_t>>;
+
+public:
+    explicit HopSearch(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_stamp{0}
+        , m_stamps{resource}
+    {}
+
+    /**
+     * Fills reached with (vertex, distance) pairs of every vertex at most
+     * hops away from the nearest seed, seeds first, ordered by distance.
+     */
+    template <typename Graph, typename Seeds>
+    void expand(const Graph& graph, const Seeds& seeds, uint32_t hops, Reached& reached)
+    {
+        reached.clear();
+        prepare(graph.indexBound());
+        for (const auto seed : seeds)
+        {
+            if (mark(graph.index(seed)))
+            {
+                reached.emplace_back(seed, 0);
+            }
+        }
+
+        auto first = std::size_t{0};
+        for (auto distance = 1u; distance <= hops && first < reached.size(); ++distance)
+        {
+            const auto last = reached.size();
+            for (auto i = first; i < last; ++i)
+            {
+                graph.forEachNeighbour(reached[i].first, [&](uint32_t next)
+                {
+                    if (mark(graph.index(next)))
+                    {
+                        reached.emplace_back(next, distance);
+                    }
+                    return false;
+                });
+            }
+            first = last;
+        }
+    }
+
+private:
+    void prepare(uint32_t indexBound)
+    {
+        if (m_stamps.size() < indexBound)
+        {
+            m_stamps.resize(indexBound, 0);
+        }
+
+        if (++m_stamp == 0)
+        {
+            std::fill(m_stamps.begin(), m_stamps.end(), 0);
+            m_stamp = 1;
+        }
+    }
+
+    bool mark(uint32_t vertexIndex)
+    {
+        if (m_stamps[vertexIndex] == m_stamp)
+        {
+            return false;
+        }
+        m_stamps[vertexIndex] = m_stamp;
+        return true;
+    }
+
+private:
+    uint32_t m_stamp;
+    std::pmr::vector<uint32_t> m_stamps;
+};
+
+}  // namespace utils
+}  // namespace mesh
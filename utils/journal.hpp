@@ -0,0 +1,662 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <inttypes.h>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mesh.hpp"
+#include "utils/changelog.hpp"
+#include "utils/compactformat.hpp"
+#include "utils/execution.hpp"
+#include "utils/mappedfile.hpp"
+#include "utils/meshpack.hpp"
+#include "utils/packformat.hpp"
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Write-ahead log of a mesh kept in a directory, so the mesh survives a
+ * crash. Every change is appended to memory as a record of its effect on
+ * nodes and edges, commit() writes all records since the last one with a
+ * single write and makes them durable with a single fdatasync. Records are
+ * written without sync also when PENDING_LIMIT bytes gather, at the end of
+ * the mesh operation that passed it, so a frame never holds part of one.
+ *
+ * The directory keeps version 2 packs (see MeshPack::to_file) named
+ * snapshot.<generation> and logs named journal.<generation>, a snapshot
+ * holds the state from before the log of the same generation. Opening
+ * loads the newest snapshot into the mesh and replays logs from its
+ * generation on, node and edge IDs come back as they were. The last frame
+ * of the newest log, when it is cut short or fails its checksum (a crash
+ * during write), is dropped, as is a tail of zero bytes. Any other damage,
+ * a frame header failing its own check included, throws. An empty
+ * directory takes the current mesh.
+ *
+ * compact() starts a new log and writes the mesh as a new snapshot on
+ * another thread, older files are removed once it is durable. It happens
+ * on its own after commit when the log outgrows the compaction threshold
+ * (0 turns it off). The mesh must not be moved while journaled, the
+ * current node of a builder is not logged.
+ *
+ * Log file is a sequence of frames:
+ *     JournalFrame                     size and checksum of records, check of both
+ *     records                          one byte operation and its varints
+ * Descriptions are varint length and bytes.
+ */
+template <typename NodeDescription,
+          typename EdgeDescription = NodeDescription,
+          typename Storage = objects::types::HashStorage>
+class Journal : public IChangeLog<NodeDescription, EdgeDescription>
+{
+public:
+    static constexpr std::size_t PENDING_LIMIT = std::size_t{1} << 20;
+    static constexpr uint64_t DEFAULT_COMPACTION_THRESHOLD = uint64_t{64} << 20;
+
+    struct JournalFrame
+    {
+        uint32_t size;
+        uint32_t headerCheck;
+        uint64_t checksum;
+
+        uint32_t check() const
+        {
+            auto result = PackChecksum{};
+            result.update(reinterpret_cast<const char*>(&size), sizeof(size));
+            result.update(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+            const auto value = result.value();
+            return static_cast<uint32_t>(value ^ (value >> 32));
+        }
+    };
+
+    enum class Operation : uint8_t
+    {
+        INSERT_NODE = 1,
+        INSERT_EDGE,
+        ERASE_NODE,
+        ERASE_EDGE,
+        EDIT,
+        CLEAR,
+    };
+
+public:
+    explicit Journal(Mesh<NodeDescription, EdgeDescription, Storage>& mesh,
+                     std::filesystem::path directory,
+                     uint64_t compactionThreshold = DEFAULT_COMPACTION_THRESHOLD)
+        : m_mesh{mesh}
+        , m_directory{std::move(directory)}
+        , m_compactionThreshold{compactionThreshold}
+        , m_generation{0}
+        , m_descriptor{-1}
+        , m_logSize{0}
+        , m_pending(sizeof(JournalFrame), '\0')
+        , m_compaction{}
+    {
+        if (m_mesh.m_changeLog)
+        {
+            throw std::logic_error{"Mesh is journaled already"};
+        }
+
+        std::filesystem::create_directories(m_directory);
+        recover();
+        m_mesh.m_changeLog = this;
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    /** Commits and waits for compaction, call them first to see their errors. */
+    ~Journal() override
+    {
+        try
+        {
+            commit();
+            wait();
+        }
+        catch (...)
+        {
+        }
+        m_mesh.m_changeLog = nullptr;
+        ::close(m_descriptor);
+    }
+
+    /** Makes every change so far durable. */
+    void commit()
+    {
+        sync();
+        if (m_compactionThreshold != 0 && m_logSize >= m_compactionThreshold && !compacting())
+        {
+            compact();
+        }
+    }
+
+    /** Folds the log into a new snapshot, waits for the previous compaction. */
+    void compact()
+    {
+        wait();
+        sync();
+
+        auto image = MeshPack<NodeDescription, EdgeDescription, Storage>{m_mesh}.to_image(execution::par);
+        openJournal(m_generation + 1);
+        m_compaction = std::async(std::launch::async,
+                                  [directory = m_directory, generation = m_generation, image = std::move(image)]
+                                  {
+                                      writeSnapshot(directory, generation, image);
+                                      removeBefore(directory, generation);
+                                  });
+    }
+
+    /** Waits for compaction in progress, rethrows its error. */
+    void wait()
+    {
+        if (m_compaction.valid())
+        {
+            m_compaction.get();
+        }
+    }
+
+    uint64_t generation() const { return m_generation; }
+
+    /** Bytes of the current log, with the ones not written yet. */
+    uint64_t logSize() const { return m_logSize + m_pending.size() - sizeof(JournalFrame); }
+
+    void insertNode(uint32_t nodeId, const NodeDescription& description) override
+    {
+        record(Operation::INSERT_NODE);
+        putVarint(m_pending, nodeId);
+        putDescription(description);
+    }
+
+    void insertEdge(uint32_t edgeId, uint32_t firstNodeId, uint32_t secondNodeId,
+                    const EdgeDescription& description) override
+    {
+        record(Operation::INSERT_EDGE);
+        putVarint(m_pending, edgeId);
+        putVarint(m_pending, firstNodeId);
+        putVarint(m_pending, secondNodeId);
+        putDescription(description);
+    }
+
+    void eraseNode(uint32_t nodeId) override
+    {
+        record(Operation::ERASE_NODE);
+        putVarint(m_pending, nodeId);
+    }
+
+    void eraseEdge(uint32_t edgeId) override
+    {
+        record(Operation::ERASE_EDGE);
+        putVarint(m_pending, edgeId);
+    }
+
+    void edit(uint32_t nodeId, const NodeDescription& description) override
+    {
+        record(Operation::EDIT);
+        putVarint(m_pending, nodeId);
+        putDescription(description);
+    }
+
+    void clear() override
+    {
+        record(Operation::CLEAR);
+    }
+
+    void operationEnd() override
+    {
+        if (m_pending.size() >= PENDING_LIMIT)
+        {
+            write();
+        }
+    }
+
+private:
+    void sync()
+    {
+        write();
+        if (::fdatasync(m_descriptor) != 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "fdatasync " + journalPath(m_generation).string()};
+        }
+    }
+
+    void record(Operation operation)
+    {
+        m_pending.push_back(static_cast<char>(operation));
+    }
+
+    template <typename Description>
+    void putDescription(const Description& description)
+    {
+        if constexpr (std::is_convertible_v<const Description&, std::string_view>)
+        {
+            const auto bytes = std::string_view{description};
+            putVarint(m_pending, bytes.size());
+            m_pending.append(bytes);
+        }
+        else
+        {
+            auto result = std::ostringstream{};
+            result << description;
+            const auto bytes = result.str();
+            putVarint(m_pending, bytes.size());
+            m_pending.append(bytes);
+        }
+    }
+
+    /** Writes pending records as one frame, without sync. */
+    void write()
+    {
+        const auto size = m_pending.size() - sizeof(JournalFrame);
+        if (size == 0)
+        {
+            return;
+        }
+        if (size > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::length_error{"Journal frame is too big"};
+        }
+
+        auto checksum = PackChecksum{};
+        checksum.update(m_pending.data() + sizeof(JournalFrame), size);
+        auto frame = JournalFrame{static_cast<uint32_t>(size), 0, checksum.value()};
+        frame.headerCheck = frame.check();
+        std::memcpy(m_pending.data(), &frame, sizeof(frame));
+
+        try
+        {
+            writeAll(m_descriptor, m_pending, journalPath(m_generation));
+        }
+        catch (...)
+        {
+            if (::ftruncate(m_descriptor, static_cast<off_t>(m_logSize)) != 0)
+            {
+                throw std::system_error{errno, std::generic_category(), "ftruncate " + journalPath(m_generation).string()};
+            }
+            throw;
+        }
+        m_logSize += m_pending.size();
+        m_pending.resize(sizeof(JournalFrame));
+    }
+
+    bool compacting() const
+    {
+        return m_compaction.valid() && m_compaction.wait_for(std::chrono::seconds{0}) != std::future_status::ready;
+    }
+
+    void recover()
+    {
+        auto snapshots = std::map<uint64_t, std::filesystem::path>{};
+        auto journals = std::map<uint64_t, std::filesystem::path>{};
+        for (const auto& entry : std::filesystem::directory_iterator{m_directory})
+        {
+            const auto& path = entry.path();
+            if (path.extension() == ".tmp")
+            {
+                std::filesystem::remove(path);
+            }
+            else if (const auto generation = generationOf(path, "snapshot."))
+            {
+                snapshots.emplace(*generation, path);
+            }
+            else if (const auto generation = generationOf(path, "journal."))
+            {
+                journals.emplace(*generation, path);
+            }
+        }
+
+        if (snapshots.empty() && journals.empty())
+        {
+            if (!m_mesh.m_nodes.empty())
+            {
+                writeSnapshot(m_directory, 1, MeshPack<NodeDescription, EdgeDescription, Storage>{m_mesh}.to_image(execution::par));
+            }
+            openJournal(1);
+            return;
+        }
+
+        const auto generation = snapshots.empty() ? uint64_t{1} : snapshots.rbegin()->first;
+        if (snapshots.empty())
+        {
+            m_mesh.clear();
+        }
+        else
+        {
+            MeshPack<NodeDescription, EdgeDescription, Storage>{m_mesh}.from_file(snapshots.rbegin()->second);
+        }
+
+        auto next = generation;
+        for (auto it = journals.lower_bound(generation); it != journals.end(); ++it, ++next)
+        {
+            if (it->first != next)
+            {
+                throw std::invalid_argument{journalPath(next).string() + " is missing"};
+            }
+
+            const auto valid = replay(it->second);
+            if (valid != std::filesystem::file_size(it->second))
+            {
+                if (std::next(it) != journals.end())
+                {
+                    throw std::invalid_argument{it->second.string() + " is damaged at byte " + std::to_string(valid)};
+                }
+                std::filesystem::resize_file(it->second, valid);
+            }
+        }
+        m_mesh.restoreIds();
+
+        removeBefore(m_directory, generation);
+        openJournal(std::max(generation, next - 1));
+    }
+
+    /**
+     * Applies whole frames of a log, returns the size of its valid beginning.
+     * Only the last frame may be invalid, a bad frame followed by others throws.
+     */
+    uint64_t replay(const std::filesystem::path& path)
+    {
+        const auto input = MappedFile{path};
+        const auto damaged = [&path](std::size_t offset)
+        {
+            return std::invalid_argument{path.string() + " has a damaged frame at byte " + std::to_string(offset)};
+        };
+
+        auto offset = std::size_t{0};
+        while (input.size() - offset >= sizeof(JournalFrame))
+        {
+            auto frame = JournalFrame{};
+            std::memcpy(&frame, input.data() + offset, sizeof(frame));
+            if (frame.headerCheck != frame.check())
+            {
+                const auto* tail = input.data() + offset;
+                if (std::any_of(tail, input.data() + input.size(), [](char byte) { return byte != 0; }))
+                {
+                    throw damaged(offset);
+                }
+                break;
+            }
+            if (frame.size > input.size() - offset - sizeof(frame))
+            {
+                break;
+            }
+
+            const auto* records = input.data() + offset + sizeof(frame);
+            auto checksum = PackChecksum{};
+            checksum.update(records, frame.size);
+            if (checksum.value() != frame.checksum)
+            {
+                if (offset + sizeof(frame) + frame.size != input.size())
+                {
+                    throw damaged(offset);
+                }
+                break;
+            }
+
+            apply(records, records + frame.size, path);
+            offset += sizeof(frame) + frame.size;
+        }
+        return offset;
+    }
+
+    void apply(const char* cursor, const char* end, const std::filesystem::path& path)
+    {
+        auto& mesh = m_mesh;
+        const auto fail = [&path](const char* reason)
+        {
+            throw std::invalid_argument{path.string() + " has a damaged record, " + reason};
+        };
+        const auto id = [&cursor, end, &fail]()
+        {
+            auto value = uint64_t{};
+            if (!getVarint(cursor, end, value) || value == 0 || value > std::numeric_limits<uint32_t>::max())
+            {
+                fail("bad ID");
+            }
+            return static_cast<uint32_t>(value);
+        };
+        const auto description = [&cursor, end, &fail]()
+        {
+            auto size = uint64_t{};
+            if (!getVarint(cursor, end, size) || size > static_cast<uint64_t>(end - cursor))
+            {
+                fail("bad description");
+            }
+            const auto result = std::string{cursor, static_cast<std::size_t>(size)};
+            cursor += size;
+            return result;
+        };
+
+        while (cursor != end)
+        {
+            switch (static_cast<Operation>(*cursor++))
+            {
+            case Operation::INSERT_NODE:
+            {
+                const auto nodeId = id();
+                if (mesh.insertNode(NodeDescription{description()}, nodeId) == 0)
+                {
+                    fail("node ID is taken");
+                }
+                break;
+            }
+            case Operation::INSERT_EDGE:
+            {
+                const auto edgeId = id();
+                const auto firstNodeId = id();
+                const auto secondNodeId = id();
+                if (firstNodeId == secondNodeId ||
+                    !mesh.contains(mesh.m_nodes, firstNodeId) ||
+                    !mesh.contains(mesh.m_nodes, secondNodeId) ||
+                    mesh.edgeBetween(firstNodeId, secondNodeId) != 0 ||
+                    mesh.insertEdge({firstNodeId, secondNodeId}, EdgeDescription{description()}, edgeId) == 0)
+                {
+                    fail("edge does not fit");
+                }
+                mesh.m_nodes[firstNodeId].edges().insert(edgeId);
+                mesh.m_nodes[secondNodeId].edges().insert(edgeId);
+                break;
+            }
+            case Operation::ERASE_NODE:
+            {
+                const auto nodeIt = mesh.m_nodes.find(id());
+                if (nodeIt == mesh.m_nodes.end() || !nodeIt->second.edges().empty())
+                {
+                    fail("node is missing or has edges");
+                }
+                mesh.eraseNode(nodeIt->first);
+                break;
+            }
+            case Operation::ERASE_EDGE:
+            {
+                const auto edgeId = id();
+                const auto edgeIt = mesh.m_edges.find(edgeId);
+                if (edgeIt == mesh.m_edges.end())
+                {
+                    fail("edge is missing");
+                }
+                const auto endpoints = edgeIt->second.nodes();
+                mesh.m_nodes[endpoints.first].edges().erase(edgeId);
+                mesh.m_nodes[endpoints.second].edges().erase(edgeId);
+                mesh.eraseEdge(edgeId);
+                break;
+            }
+            case Operation::EDIT:
+            {
+                const auto nodeId = id();
+                if (!mesh.edit(nodeId, NodeDescription{description()}))
+                {
+                    fail("node is missing");
+                }
+                break;
+            }
+            case Operation::CLEAR:
+                mesh.clear();
+                break;
+            default:
+                fail("unknown operation");
+            }
+        }
+    }
+
+    /** Switches to a fresh or recovered log of given generation. */
+    void openJournal(uint64_t generation)
+    {
+        const auto path = journalPath(generation);
+        const auto descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (descriptor < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "open " + path.string()};
+        }
+        syncDirectory(m_directory);
+
+        if (m_descriptor >= 0)
+        {
+            ::close(m_descriptor);
+        }
+        m_descriptor = descriptor;
+        m_generation = generation;
+        m_logSize = std::filesystem::file_size(path);
+    }
+
+    std::filesystem::path journalPath(uint64_t generation) const
+    {
+        return m_directory / ("journal." + std::to_string(generation));
+    }
+
+    static std::optional<uint64_t> generationOf(const std::filesystem::path& path, std::string_view prefix)
+    {
+        const auto name = path.filename().string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0)
+        {
+            return {};
+        }
+
+        auto result = uint64_t{};
+        const auto* last = name.data() + name.size();
+        const auto [end, error] = std::from_chars(name.data() + prefix.size(), last, result);
+        if (error != std::errc{} || end != last || result == 0)
+        {
+            return {};
+        }
+        return result;
+    }
+
+    /** Writes the snapshot under a temporary name and renames it when it is durable. */
+    template <typename Image>
+    static void writeSnapshot(const std::filesystem::path& directory, uint64_t generation, const Image& image)
+    {
+        const auto path = directory / ("snapshot." + std::to_string(generation));
+        auto temporary = path;
+        temporary += ".tmp";
+
+        const auto descriptor = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (descriptor < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "open " + temporary.string()};
+        }
+
+        try
+        {
+            image.write([descriptor, &temporary](std::string_view bytes) { writeAll(descriptor, bytes, temporary); });
+            if (::fsync(descriptor) != 0)
+            {
+                throw std::system_error{errno, std::generic_category(), "fsync " + temporary.string()};
+            }
+        }
+        catch (...)
+        {
+            ::close(descriptor);
+            throw;
+        }
+        ::close(descriptor);
+
+        std::filesystem::rename(temporary, path);
+        syncDirectory(directory);
+    }
+
+    /** Removes snapshots and logs older than given generation. */
+    static void removeBefore(const std::filesystem::path& directory, uint64_t generation)
+    {
+        for (const auto& entry : std::filesystem::directory_iterator{directory})
+        {
+            auto fileGeneration = generationOf(entry.path(), "snapshot.");
+            if (!fileGeneration)
+            {
+                fileGeneration = generationOf(entry.path(), "journal.");
+            }
+            if (fileGeneration && *fileGeneration < generation)
+            {
+                std::filesystem::remove(entry.path());
+            }
+        }
+    }
+
+    static void writeAll(int descriptor, std::string_view bytes, const std::filesystem::path& path)
+    {
+        while (!bytes.empty())
+        {
+            const auto written = ::write(descriptor, bytes.data(), bytes.size());
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::system_error{errno, std::generic_category(), "write " + path.string()};
+            }
+            bytes.remove_prefix(static_cast<std::size_t>(written));
+        }
+    }
+
+    static void syncDirectory(const std::filesystem::path& directory)
+    {
+        const auto descriptor = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (descriptor < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "open " + directory.string()};
+        }
+        const auto result = ::fsync(descriptor);
+        const auto error = errno;
+        ::close(descriptor);
+        if (result != 0)
+        {
+            throw std::system_error{error, std::generic_category(), "fsync " + directory.string()};
+        }
+    }
+
+private:
+    Mesh<NodeDescription, EdgeDescription, Storage>& m_mesh;
+    std::filesystem::path m_directory;
+    uint64_t m_compactionThreshold;
+    uint64_t m_generation;
+    int m_descriptor;
+    uint64_t m_logSize;
+    std::string m_pending;
+    std::future<void> m_compaction;
+};
+
+}  // namespace utils
+}  // namespace mesh
@@ -0,0 +1,265 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <inttypes.h>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "utils/execution.hpp"
+#include "utils/threadpool.hpp"
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/** Adjacency of a mesh copied into compressed rows over dense node indices. */
+struct AdjacencySnapshot
+{
+    explicit AdjacencySnapshot(std::pmr::memory_resource* resource)
+        : offsets{resource}
+        , neighbours{resource}
+        , vertices{resource}
+    {}
+
+    std::pmr::vector<uint32_t> offsets;
+    std::pmr::vector<uint32_t> neighbours;
+    std::pmr::vector<uint32_t> vertices;
+};
+
+/**
+ * Hop distances from K landmark nodes to every node (ALT). Triangle
+ * inequality gives max |d(l, a) - d(l, b)| as a lower bound and
+ * min d(l, a) + d(l, b) as an upper bound of the distance between a and b.
+ * Landmarks are chosen farthest first, one batch per round of the shared pool.
+ */
+class Landmarks
+{
+public:
+    static constexpr auto UNREACHABLE = std::numeric_limits<uint32_t>::max();
+
+public:
+    explicit Landmarks(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_count{0}
+        , m_distances{resource}
+    {}
+
+    void build(const AdjacencySnapshot& snapshot, uint32_t count)
+    {
+        const auto indexBound = snapshot.offsets.empty() ? 0 : snapshot.offsets.size() - 1;
+        m_count = std::min<uint32_t>(count, static_cast<uint32_t>(snapshot.vertices.size()));
+        m_distances.assign(indexBound * m_count, UNREACHABLE);
+        if (m_count == 0)
+        {
+            return;
+        }
+
+        auto nearest = std::vector<uint32_t>(indexBound, UNREACHABLE);
+        const auto workers = sharedPool().size();
+        auto queues = std::vector<std::vector<uint32_t>>(workers);
+        auto batch = std::vector<uint32_t>{};
+        auto chosen = 0u;
+        while (chosen < m_count)
+        {
+            const auto batchSize = (chosen == 0) ? 1u : std::min(workers, m_count - chosen);
+            pickFarthest(snapshot, nearest, batchSize, batch);
+            forEachPart(batch.size(), batch.size(), [&](std::size_t part, std::size_t first, std::size_t last)
+            {
+                for (auto i = first; i < last; ++i)
+                {
+                    distancesFrom(snapshot, batch[i], chosen + static_cast<uint32_t>(i), queues[part]);
+                }
+            });
+
+            for (auto i = 0u; i < batch.size(); ++i)
+            {
+                for (const auto vertex : snapshot.vertices)
+                {
+                    nearest[vertex] = std::min(nearest[vertex], distance(chosen + i, vertex));
+                }
+            }
+            chosen += static_cast<uint32_t>(batch.size());
+        }
+    }
+
+    uint32_t count() const { return m_count; }
+
+    uint32_t lowerBound(uint32_t first, uint32_t second) const
+    {
+        auto result = 0u;
+        for (auto landmark = 0u; landmark < m_count; ++landmark)
+        {
+            const auto firstDistance = distance(landmark, first);
+            const auto secondDistance = distance(landmark, second);
+            if (firstDistance != UNREACHABLE && secondDistance != UNREACHABLE)
+            {
+                result = std::max(result, firstDistance > secondDistance ? firstDistance - secondDistance :
+                                                                           secondDistance - firstDistance);
+            }
+        }
+        return result;
+    }
+
+    uint32_t upperBound(uint32_t first, uint32_t second) const
+    {
+        auto result = UNREACHABLE;
+        for (auto landmark = 0u; landmark < m_count; ++landmark)
+        {
+            const auto firstDistance = distance(landmark, first);
+            const auto secondDistance = distance(landmark, second);
+            if (firstDistance != UNREACHABLE && secondDistance != UNREACHABLE)
+            {
+                result = std::min(result, firstDistance + secondDistance);
+            }
+        }
+        return result;
+    }
+
+    /** True if some landmark reaches only one of the nodes, so there is no path between them. */
+    bool separated(uint32_t first, uint32_t second) const
+    {
+        for (auto landmark = 0u; landmark < m_count; ++landmark)
+        {
+            if ((distance(landmark, first) == UNREACHABLE) != (distance(landmark, second) == UNREACHABLE))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    uint32_t distance(uint32_t landmark, uint32_t vertex) const
+    {
+        return m_distances[static_cast<std::size_t>(vertex) * m_count + landmark];
+    }
+
+    void pickFarthest(const AdjacencySnapshot& snapshot,
+                      const std::vector<uint32_t>& nearest,
+                      uint32_t count,
+                      std::vector<uint32_t>& batch) const
+    {
+        batch.clear();
+        for (const auto vertex : snapshot.vertices)
+        {
+            if (nearest[vertex] != 0)
+            {
+                batch.push_back(vertex);
+            }
+        }
+
+        const auto isFarther = [&nearest](uint32_t lhs, uint32_t rhs) { return nearest[lhs] > nearest[rhs]; };
+        count = std::min<uint32_t>(count, static_cast<uint32_t>(batch.size()));
+        std::partial_sort(batch.begin(), batch.begin() + count, batch.end(), isFarther);
+        batch.resize(count);
+    }
+
+    void distancesFrom(const AdjacencySnapshot& snapshot, uint32_t source, uint32_t landmark, std::vector<uint32_t>& queue)
+    {
+        queue.clear();
+        queue.push_back(source);
+        m_distances[static_cast<std::size_t>(source) * m_count + landmark] = 0;
+        for (auto i = std::size_t{0}; i < queue.size(); ++i)
+        {
+            const auto vertex = queue[i];
+            const auto nextDistance = distance(landmark, vertex) + 1;
+            for (auto arc = snapshot.offsets[vertex]; arc < snapshot.offsets[vertex + 1]; ++arc)
+            {
+                auto& nextSlot = m_distances[static_cast<std::size_t>(snapshot.neighbours[arc]) * m_count + landmark];
+                if (nextSlot == UNREACHABLE)
+                {
+                    nextSlot = nextDistance;
+                    queue.push_back(snapshot.neighbours[arc]);
+                }
+            }
+        }
+    }
+
+private:
+    uint32_t m_count;
+    std::pmr::vector<uint32_t> m_distances;
+};
+
+/**
+ * Landmarks of one mesh together with the topology version they were built
+ * for. A stale index is not used, refresh() rebuilds it in the background
+ * from an adjacency snapshot and swaps it in once done. Landmarks allocate
+ * from the snapshot's memory resource, which has to be thread-safe for
+ * refresh().
+ */
+class LandmarkIndex
+{
+public:
+    explicit LandmarkIndex(uint32_t count)
+        : m_count{count}
+        , m_version{0}
+        , m_landmarks{}
+        , m_pendingVersion{0}
+        , m_pending{}
+    {}
+
+    uint32_t count() const { return m_count; }
+
+    void rebuild(AdjacencySnapshot snapshot, uint64_t version)
+    {
+        m_landmarks = build(std::move(snapshot), m_count);
+        m_version = version;
+    }
+
+    void refresh(AdjacencySnapshot snapshot, uint64_t version)
+    {
+        if (m_pending.valid())
+        {
+            return;
+        }
+
+        m_pendingVersion = version;
+        m_pending = std::async(std::launch::async,
+                               [snapshot = std::move(snapshot), count = m_count]() mutable
+                               {
+                                   return build(std::move(snapshot), count);
+                               });
+    }
+
+    bool isRefreshing() const
+    {
+        return m_pending.valid();
+    }
+
+    /** Landmarks built for given topology version, nullptr if there are none yet. */
+    const Landmarks* current(uint64_t version)
+    {
+        if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds{0}) == std::future_status::ready)
+        {
+            m_landmarks = m_pending.get();
+            m_version = m_pendingVersion;
+        }
+        return (m_landmarks && m_version == version) ? m_landmarks.get() : nullptr;
+    }
+
+private:
+    static std::unique_ptr<Landmarks> build(AdjacencySnapshot snapshot, uint32_t count)
+    {
+        auto landmarks = std::make_unique<Landmarks>(snapshot.offsets.get_allocator().resource());
+        landmarks->build(snapshot, count);
+        return landmarks;
+    }
+
+private:
+    uint32_t m_count;
+    uint64_t m_version;
+    std::unique_ptr<Landmarks> m_landmarks;
+    uint64_t m_pendingVersion;
+    std::future<std::unique_ptr<Landmarks>> m_pending;
+};
+
+}  // namespace utils
+}  // namespace mesh
@@ -0,0 +1,92 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/** Whole file mapped read-only into memory, unmapped on destruction. */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::filesystem::path& filename)
+        : m_data{nullptr}
+        , m_size{0}
+    {
+        const auto descriptor = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "open " + filename.string()};
+        }
+
+        struct stat status = {};
+        if (::fstat(descriptor, &status) != 0)
+        {
+            const auto error = errno;
+            ::close(descriptor);
+            throw std::system_error{error, std::generic_category(), "stat " + filename.string()};
+        }
+
+        m_size = static_cast<std::size_t>(status.st_size);
+        if (m_size != 0)
+        {
+            auto* data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, descriptor, 0);
+            if (data == MAP_FAILED)
+            {
+                const auto error = errno;
+                ::close(descriptor);
+                throw std::system_error{error, std::generic_category(), "mmap " + filename.string()};
+            }
+            m_data = static_cast<const char*>(data);
+        }
+        ::close(descriptor);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+        : m_data{std::exchange(other.m_data, nullptr)}
+        , m_size{std::exchange(other.m_size, 0)}
+    {}
+
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        if (m_data)
+        {
+            ::munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    const char* m_data;
+    std::size_t m_size;
+};
+
+}  // namespace utils
+}  // namespace mesh
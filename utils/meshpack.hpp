@@ -3,12 +3,33 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <istream>
+#include <numeric>
 #include <optional>
-
+#include <ostream>
+#include <sstream>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mappedview.hpp"
 #include "mesh.hpp"
 #include "objects/types.hpp"
+#include "utils/compactformat.hpp"
+#include "utils/execution.hpp"
+#include "utils/mappedfile.hpp"
+#include "utils/packformat.hpp"
+#include "utils/textreader.hpp"
 
 
 namespace mesh
@@ -16,45 +37,59 @@ namespace mesh
 namespace utils
 {
 
-template <typename NodeDescription, typename EdgeDescription>
+template <typename NodeDescription, typename EdgeDescription, typename Storage>
 class MeshPack
 {
 public:
-    struct StringFile
-    {
-        std::size_t cursor = {};
-        std::string data = {};
-    };
-
-public:
-    explicit MeshPack(Mesh<NodeDescription, EdgeDescription>& mesh)
+    explicit MeshPack(Mesh<NodeDescription, EdgeDescription, Storage>& mesh)
         : m_mesh{mesh}
     {}
 
     std::string to_string() const
     {
-        auto result = std::stringstream{};
+        return to_string(execution::seq);
+    }
 
-        result << m_mesh.m_nodes.size() << ';' << m_mesh.m_edges.size() << '\n';
-        for (const auto& nodeItem : m_mesh.m_nodes)
-        {
-            result << nodeItem.first << ";\"" << nodeItem.second.value() << "\"\n";
-        }
-        for (const auto& edgeItem : m_mesh.m_edges)
+    /** Parallel policies format parts of the mesh on separate threads, elements come in storage slot order then. */
+    template <typename Policy, typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    std::string to_string(Policy policy) const
+    {
+        auto result = std::string{};
+        write_text(policy, [&result](std::string_view chunk) { result.append(chunk); });
+        return result;
+    }
+
+    bool to_stream(std::ostream& output) const
+    {
+        return to_stream(output, execution::seq);
+    }
+
+    /** Writes the same text as to_string in big chunks, memory does not grow with the mesh. */
+    template <typename Policy, typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    bool to_stream(std::ostream& output, Policy policy) const
+    {
+        write_text(policy, [&output](std::string_view chunk)
         {
-            result << edgeItem.first << ';'
-                   << edgeItem.second.nodes().first << ';'
-                   << edgeItem.second.nodes().second << ";\""
-                   << edgeItem.second.value() << "\"\n";
-        }
+            output.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        });
+        return static_cast<bool>(output.flush());
+    }
 
-        return result.str();
+    bool from_string(std::string_view data)
+    {
+        auto str = TextReader{data};
+        mesh_load(m_mesh,
+                  str,
+                  [](auto& mesh, auto desc) { return mesh.insertNode(std::move(desc)); },
+                  [](auto& mesh, auto f, auto s, auto desc) { return mesh.insertEdge({f, s}, std::move(desc)); },
+                  [](auto& mesh, auto nId, auto eId) { return mesh.m_nodes[nId].edges().insert(eId); });
+        return true;
     }
 
-    bool from_string(std::string data)
+    /** Reads text written by to_string chunk by chunk, errors tell the byte offset. */
+    bool from_stream(std::istream& input)
     {
-        constexpr auto POS_ZERO = 0u;
-        StringFile str{POS_ZERO, std::move(data)};
+        auto str = TextReader{input};
         mesh_load(m_mesh,
                   str,
                   [](auto& mesh, auto desc) { return mesh.insertNode(std::move(desc)); },
@@ -63,46 +98,340 @@ public:
         return true;
     }
 
+    /**
+     * Version 2 pack built in memory, it does not refer to the mesh, so it
+     * could be written out later and by another thread.
+     */
+    class PackImage
+    {
+        friend class MeshPack;
+
+    public:
+        /** Calls sink(bytes) with consecutive pieces of the file. */
+        template <typename Sink>
+        void write(Sink&& sink) const
+        {
+            sink(std::string_view{reinterpret_cast<const char*>(&m_header), sizeof(m_header)});
+            forEachSection(sink);
+        }
+
+    private:
+        /** Tables and descriptions of a consecutive range of nodes or edges. */
+        struct Part
+        {
+            std::vector<PackNode> nodes;
+            std::vector<uint32_t> neighbours;
+            std::vector<uint32_t> edgeIds;
+            std::vector<PackEdge> edges;
+            std::string strings;
+        };
+
+        template <typename Function>
+        void forEachSection(Function&& function) const
+        {
+            static constexpr char ZEROS[sizeof(uint64_t)] = {};
+            const auto arcsSize = m_header.arcCount * sizeof(uint32_t);
+            const auto padding = std::string_view{ZEROS, PackLayout::padded(arcsSize) - arcsSize};
+
+            for (const auto& part : m_nodeParts)
+            {
+                function(bytes(part.nodes));
+            }
+            for (const auto& part : m_nodeParts)
+            {
+                function(bytes(part.neighbours));
+            }
+            function(padding);
+            for (const auto& part : m_nodeParts)
+            {
+                function(bytes(part.edgeIds));
+            }
+            function(padding);
+            for (const auto& part : m_edgeParts)
+            {
+                function(bytes(part.edges));
+            }
+            for (const auto& part : m_nodeParts)
+            {
+                function(std::string_view{part.strings});
+            }
+            for (const auto& part : m_edgeParts)
+            {
+                function(std::string_view{part.strings});
+            }
+        }
+
+    private:
+        PackHeader m_header = {};
+        std::vector<Part> m_nodeParts;
+        std::vector<Part> m_edgeParts;
+    };
+
+    /** Writes version 2 pack, which could be opened in place by MappedView. */
     bool to_file(std::filesystem::path filename) const
     {
+        return to_file(std::move(filename), execution::seq);
+    }
+
+    /** Parallel policies build the tables of the pack on separate threads, the file is the same. */
+    template <typename Policy, typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    bool to_file(std::filesystem::path filename, Policy policy) const
+    {
+        const auto image = to_image(policy);
         auto output = std::ofstream{filename, std::ios::binary | std::ios::trunc};
-        auto nodeSize = static_cast<uint32_t>(m_mesh.m_nodes.size());
-        auto edgeSize = static_cast<uint32_t>(m_mesh.m_edges.size());
-        output.write(reinterpret_cast<char*>(&nodeSize), sizeof(nodeSize));
-        output.write(reinterpret_cast<char*>(&edgeSize), sizeof(edgeSize));
+        image.write([&output](std::string_view bytes)
+        {
+            output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        });
+        return static_cast<bool>(output.flush());
+    }
 
-        for (const auto& nodeItem : m_mesh.m_nodes)
+    /** The contents of to_file, which keep node and edge IDs. */
+    template <typename Policy, typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    PackImage to_image(Policy policy) const
+    {
+        const auto nodeIds = sortedIds(m_mesh.m_nodes);
+        const auto edgeIds = sortedIds(m_mesh.m_edges);
+        const auto nodeIndex = [&nodeIds](uint32_t nodeId)
+        {
+            return static_cast<uint32_t>(std::lower_bound(nodeIds.cbegin(), nodeIds.cend(), nodeId) - nodeIds.cbegin());
+        };
+
+        auto image = PackImage{};
+        auto& nodeParts = image.m_nodeParts;
+        nodeParts.resize(partCount(policy, nodeIds.size()));
+        forEachPart(nodeParts.size(), nodeIds.size(), [&](std::size_t part, std::size_t first, std::size_t last)
+        {
+            auto& result = nodeParts[part];
+            result.nodes.reserve(last - first);
+            for (auto i = first; i < last; ++i)
+            {
+                const auto nodeId = nodeIds[i];
+                const auto& node = m_mesh.m_nodes.find(nodeId)->second;
+                const auto offset = result.strings.size();
+                append(result.strings, node.value());
+                result.nodes.push_back(PackNode{nodeId,
+                                                static_cast<uint32_t>(result.strings.size() - offset),
+                                                offset,
+                                                result.neighbours.size()});
+
+                for (const auto edgeId : node.edges())
+                {
+                    const auto& endpoints = m_mesh.m_edges.find(edgeId)->second.nodes();
+                    result.neighbours.push_back(nodeIndex(endpoints.first == nodeId ? endpoints.second : endpoints.first));
+                    result.edgeIds.push_back(edgeId);
+                }
+            }
+        });
+
+        auto& edgeParts = image.m_edgeParts;
+        edgeParts.resize(partCount(policy, edgeIds.size()));
+        forEachPart(edgeParts.size(), edgeIds.size(), [&](std::size_t part, std::size_t first, std::size_t last)
         {
-            auto nodeId = uint32_t{nodeItem.first};
-            auto description = nodeItem.second.value();
-            auto descriptionSize = static_cast<uint32_t>(description.size());
+            auto& result = edgeParts[part];
+            result.edges.reserve(last - first);
+            for (auto i = first; i < last; ++i)
+            {
+                const auto& edge = m_mesh.m_edges.find(edgeIds[i])->second;
+                const auto offset = result.strings.size();
+                append(result.strings, edge.value());
+                result.edges.push_back(PackEdge{edgeIds[i],
+                                                edge.nodes().first,
+                                                edge.nodes().second,
+                                                static_cast<uint32_t>(result.strings.size() - offset),
+                                                offset});
+            }
+        });
 
-            output.write(reinterpret_cast<char*>(&nodeId), sizeof(nodeId));
-            output.write(reinterpret_cast<char*>(&descriptionSize), sizeof(descriptionSize));
-            output.write(description.c_str(), descriptionSize);
+        auto& header = image.m_header;
+        std::copy(std::begin(PackHeader::MAGIC), std::end(PackHeader::MAGIC), header.magic);
+        header.version = PackHeader::VERSION;
+        header.headerSize = sizeof(PackHeader);
+        for (auto& part : nodeParts)
+        {
+            for (auto& node : part.nodes)
+            {
+                node.descriptionOffset += header.stringsSize;
+                node.firstArc += header.arcCount;
+            }
+            header.nodeCount += part.nodes.size();
+            header.arcCount += part.neighbours.size();
+            header.stringsSize += part.strings.size();
+        }
+        for (auto& part : edgeParts)
+        {
+            for (auto& edge : part.edges)
+            {
+                edge.descriptionOffset += header.stringsSize;
+            }
+            header.edgeCount += part.edges.size();
+            header.stringsSize += part.strings.size();
         }
 
+        auto checksum = PackChecksum{};
+        image.forEachSection([&checksum](std::string_view section) { checksum.update(section.data(), section.size()); });
+        header.checksum = checksum.value();
+        return image;
+    }
+
+    /**
+     * Writes compact version 3 pack (see CompactHeader), usually a few times
+     * smaller than to_file, but it has to be decoded before use.
+     */
+    bool to_compact_file(std::filesystem::path filename) const
+    {
+        return to_compact_file(std::move(filename), execution::seq);
+    }
+
+    /** Parallel policies encode blocks on separate threads, the file is the same. */
+    template <typename Policy, typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    bool to_compact_file(std::filesystem::path filename, Policy policy) const
+    {
+        const auto nodeIds = sortedIds(m_mesh.m_nodes);
+        const auto nodeIndex = [&nodeIds](uint32_t nodeId)
+        {
+            return static_cast<uint32_t>(std::lower_bound(nodeIds.cbegin(), nodeIds.cend(), nodeId) - nodeIds.cbegin());
+        };
+
+        auto edges = std::vector<CompactEdge>{};
+        edges.reserve(m_mesh.m_edges.size());
         for (const auto& edgeItem : m_mesh.m_edges)
         {
-            auto edgeId = uint32_t{edgeItem.first};
-            auto edgeFirstNodeId = uint32_t{edgeItem.second.nodes().first};
-            auto edgeSecondNodeId = uint32_t{edgeItem.second.nodes().second};
-            auto description = edgeItem.second.value().to_string();
-            auto descriptionSize = static_cast<uint32_t>(description.size());
+            const auto first = nodeIndex(edgeItem.second.nodes().first);
+            const auto second = nodeIndex(edgeItem.second.nodes().second);
+            edges.push_back(CompactEdge{std::min(first, second), std::max(first, second), edgeItem.first});
+        }
+        std::sort(edges.begin(), edges.end(), [](const CompactEdge& lhs, const CompactEdge& rhs)
+        {
+            return std::tie(lhs.lower, lhs.higher, lhs.word) < std::tie(rhs.lower, rhs.higher, rhs.word);
+        });
 
-            output.write(reinterpret_cast<char*>(&edgeId), sizeof(edgeId));
-            output.write(reinterpret_cast<char*>(&edgeFirstNodeId), sizeof(edgeFirstNodeId));
-            output.write(reinterpret_cast<char*>(&edgeSecondNodeId), sizeof(edgeSecondNodeId));
-            output.write(reinterpret_cast<char*>(&descriptionSize), sizeof(descriptionSize));
-            output.write(description.c_str(), descriptionSize);
+        auto dictionary = Dictionary{};
+        auto nodeWords = std::vector<uint32_t>{};
+        nodeWords.reserve(nodeIds.size());
+        for (const auto nodeId : nodeIds)
+        {
+            nodeWords.push_back(dictionary.add(m_mesh.m_nodes.find(nodeId)->second.value()));
+        }
+        for (auto& edge : edges)
+        {
+            edge.word = dictionary.add(m_mesh.m_edges.find(edge.word)->second.value());
         }
+        dictionary.rank();
+
+        auto header = CompactHeader{};
+        std::copy(std::begin(PackHeader::MAGIC), std::end(PackHeader::MAGIC), header.magic);
+        header.version = CompactHeader::VERSION;
+        header.headerSize = sizeof(CompactHeader);
+        header.nodeCount = nodeWords.size();
+        header.edgeCount = edges.size();
+        header.wordCount = dictionary.words.size();
+        header.blockSize = COMPACT_BLOCK_SIZE;
+
+        const auto wordBlocks = header.wordBlocks();
+        const auto nodeBlocks = header.nodeBlocks();
+        auto blocks = std::vector<std::string>(wordBlocks + nodeBlocks + header.edgeBlocks());
+        const auto parts = partCount(policy, header.wordCount + header.nodeCount + header.edgeCount);
+        forEachPart(std::min(parts, blocks.size()), blocks.size(), [&](std::size_t, std::size_t first, std::size_t last)
+        {
+            for (auto block = first; block < last; ++block)
+            {
+                auto& output = blocks[block];
+                if (block < wordBlocks)
+                {
+                    forEachInBlock(block, header.blockSize, dictionary.words.size(), [&](std::size_t i)
+                    {
+                        const auto word = dictionary.words[dictionary.order[i]];
+                        putVarint(output, word.size());
+                        output.append(word);
+                    });
+                }
+                else if (block < wordBlocks + nodeBlocks)
+                {
+                    forEachInBlock(block - wordBlocks, header.blockSize, nodeWords.size(), [&](std::size_t i)
+                    {
+                        putVarint(output, dictionary.ranks[nodeWords[i]]);
+                    });
+                }
+                else
+                {
+                    auto previous = uint32_t{0};
+                    forEachInBlock(block - wordBlocks - nodeBlocks, header.blockSize, edges.size(), [&](std::size_t i)
+                    {
+                        putVarint(output, edges[i].lower - previous);
+                        putVarint(output, edges[i].higher - edges[i].lower);
+                        putVarint(output, dictionary.ranks[edges[i].word]);
+                        previous = edges[i].lower;
+                    });
+                }
+            }
+        });
 
-        return true;
+        auto ends = std::vector<uint64_t>{};
+        ends.reserve(blocks.size());
+        for (const auto& block : blocks)
+        {
+            header.dataSize += block.size();
+            ends.push_back(header.dataSize);
+        }
+
+        auto checksum = PackChecksum{};
+        checksum.update(bytes(ends).data(), bytes(ends).size());
+        for (const auto& block : blocks)
+        {
+            checksum.update(block.data(), block.size());
+        }
+        header.checksum = checksum.value();
+
+        auto output = std::ofstream{filename, std::ios::binary | std::ios::trunc};
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(bytes(ends).data(), static_cast<std::streamsize>(bytes(ends).size()));
+        for (const auto& block : blocks)
+        {
+            output.write(block.data(), static_cast<std::streamsize>(block.size()));
+        }
+        return static_cast<bool>(output.flush());
     }
 
+    /**
+     * Reads version 2 and compact version 3 packs and the older field by field
+     * format. Version 2 keeps node and edge IDs, the others number them anew.
+     */
     bool from_file(std::filesystem::path filename)
+    {
+        return from_file(std::move(filename), execution::seq);
+    }
+
+    /** Parallel policies decode blocks of compact packs on separate threads. */
+    template <typename Policy, typename = std::enable_if_t<execution::isExecutionPolicy<Policy>>>
+    bool from_file(std::filesystem::path filename, Policy policy)
     {
         auto input = std::ifstream{filename, std::ios::binary};
+        auto magic = std::array<char, sizeof(PackHeader::MAGIC)>{};
+        auto version = uint32_t{};
+        input.read(magic.data(), magic.size());
+        input.read(reinterpret_cast<char*>(&version), sizeof(version));
+
+        if (input && std::equal(magic.cbegin(), magic.cend(), std::begin(PackHeader::MAGIC)))
+        {
+            input.close();
+            if (version == CompactHeader::VERSION)
+            {
+                mesh_load(m_mesh, MappedFile{filename}, policy);
+                return true;
+            }
+
+            const auto view = MappedView{filename};
+            if (!view.verify())
+            {
+                throw std::invalid_argument{filename.string() + " is damaged, checksum or tables do not match"};
+            }
+            mesh_load(m_mesh, view);
+            return true;
+        }
+
+        input.clear();
+        input.seekg(0);
         mesh_load(m_mesh,
                   input,
                   [](auto& mesh, auto desc) { return mesh.insertNode(std::move(desc)); },
@@ -112,42 +441,229 @@ public:
     }
 
 private:
+    static constexpr uint32_t COMPACT_BLOCK_SIZE = 4096;
+
+    /**
+     * Edge of a compact pack, endpoints are dense node indices. The writer
+     * keeps edge ID in word until edges are sorted.
+     */
+    struct CompactEdge
+    {
+        uint32_t lower;
+        uint32_t higher;
+        uint32_t word;
+    };
+
+    /** Distinct descriptions of a compact pack, ranked from the most frequent. */
+    struct Dictionary
+    {
+        template <typename Description>
+        uint32_t add(const Description& description)
+        {
+            auto word = std::string_view{};
+            if constexpr (std::is_convertible_v<const Description&, std::string_view>)
+            {
+                word = description;
+            }
+            else
+            {
+                auto& formatted = storage.emplace_back();
+                append(formatted, description);
+                word = formatted;
+            }
+
+            const auto [it, inserted] = indices.emplace(word, static_cast<uint32_t>(words.size()));
+            if (inserted)
+            {
+                words.push_back(word);
+                counts.push_back(0);
+            }
+            ++counts[it->second];
+            return it->second;
+        }
+
+        void rank()
+        {
+            order.resize(words.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) { return counts[lhs] > counts[rhs]; });
+
+            ranks.resize(words.size());
+            for (auto i = 0u; i < order.size(); ++i)
+            {
+                ranks[order[i]] = i;
+            }
+        }
+
+        std::deque<std::string> storage;
+        std::unordered_map<std::string_view, uint32_t> indices;
+        std::vector<std::string_view> words;
+        std::vector<uint64_t> counts;
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> ranks;
+    };
+
+    template <typename Function>
+    static void forEachInBlock(std::size_t block, std::size_t blockSize, std::size_t count, Function&& function)
+    {
+        const auto first = block * blockSize;
+        const auto last = std::min(count, first + blockSize);
+        for (auto i = first; i < last; ++i)
+        {
+            function(i);
+        }
+    }
+
+    template <typename Items>
+    static std::vector<uint32_t> sortedIds(const Items& items)
+    {
+        auto result = std::vector<uint32_t>{};
+        result.reserve(items.size());
+        for (const auto& item : items)
+        {
+            result.push_back(item.first);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    template <typename T>
+    static std::string_view bytes(const std::vector<T>& items)
+    {
+        return {reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T)};
+    }
+
+    /**
+     * Formats the text form and passes it to sink(chunk) in order. Parallel
+     * policies format slices of the storage slots on every thread in rounds,
+     * each round is flushed before the next one starts.
+     */
+    template <typename Policy, typename Sink>
+    void write_text(Policy policy, Sink&& sink) const
+    {
+        auto buffer = std::string{};
+        appendNumber(buffer, m_mesh.m_nodes.size());
+        buffer.push_back(';');
+        appendNumber(buffer, m_mesh.m_edges.size());
+        buffer.push_back('\n');
+        sink(std::string_view{buffer});
+
+        write_items(policy, m_mesh.m_nodes, sink, [](std::string& result, uint32_t id, const auto& node)
+        {
+            appendNumber(result, id);
+            result.append(";\"");
+            append(result, node.value());
+            result.append("\"\n");
+        });
+        write_items(policy, m_mesh.m_edges, sink, [](std::string& result, uint32_t id, const auto& edge)
+        {
+            appendNumber(result, id);
+            result.push_back(';');
+            appendNumber(result, edge.nodes().first);
+            result.push_back(';');
+            appendNumber(result, edge.nodes().second);
+            result.append(";\"");
+            append(result, edge.value());
+            result.append("\"\n");
+        });
+    }
+
+    template <typename Policy, typename Items, typename Sink, typename Format>
+    static void write_items(Policy policy, const Items& items, Sink& sink, Format format)
+    {
+        constexpr auto BUFFER_SIZE = std::size_t{1} << 20;
+        constexpr auto SLICE_SLOTS = std::size_t{1} << 16;
+
+        const auto slots = items.slotCount();
+        const auto parts = partCount(policy, slots);
+        if (parts == 1)
+        {
+            auto buffer = std::string{};
+            buffer.reserve(BUFFER_SIZE);
+            for (const auto& item : items)
+            {
+                format(buffer, item.first, item.second);
+                if (buffer.size() >= BUFFER_SIZE)
+                {
+                    sink(std::string_view{buffer});
+                    buffer.clear();
+                }
+            }
+            sink(std::string_view{buffer});
+            return;
+        }
+
+        auto buffers = std::vector<std::string>(parts);
+        for (auto round = std::size_t{0}; round < slots; round += parts * SLICE_SLOTS)
+        {
+            const auto roundSlots = std::min(slots - round, parts * SLICE_SLOTS);
+            forEachPart(parts, roundSlots, [&](std::size_t part, std::size_t first, std::size_t last)
+            {
+                auto& buffer = buffers[part];
+                buffer.clear();
+                items.forEachInSlots(round + first, round + last, [&](uint32_t id, const auto& item)
+                {
+                    format(buffer, id, item);
+                    return false;
+                });
+            });
+
+            for (const auto& buffer : buffers)
+            {
+                sink(std::string_view{buffer});
+            }
+        }
+    }
+
+    static void appendNumber(std::string& result, uint64_t value)
+    {
+        char digits[20];
+        const auto last = std::to_chars(std::begin(digits), std::end(digits), value).ptr;
+        result.append(digits, last);
+    }
+
     template <typename T>
-    void mesh_load(Mesh<NodeDescription, EdgeDescription>& m_mesh,
+    void mesh_load(Mesh<NodeDescription, EdgeDescription, Storage>& m_mesh,
                    T& str,
-                   std::function<uint32_t(Mesh<NodeDescription, EdgeDescription>&, NodeDescription)> nodeInsertion,
-                   std::function<uint32_t(Mesh<NodeDescription, EdgeDescription>&, uint32_t, uint32_t, EdgeDescription)> edgeInsertion,
-                   std::function<void(Mesh<NodeDescription, EdgeDescription>&, uint32_t, uint32_t)> nodeEdgesInsertion)
+                   std::function<uint32_t(Mesh<NodeDescription, EdgeDescription, Storage>&, NodeDescription)> nodeInsertion,
+                   std::function<uint32_t(Mesh<NodeDescription, EdgeDescription, Storage>&, uint32_t, uint32_t, EdgeDescription)> edgeInsertion,
+                   std::function<void(Mesh<NodeDescription, EdgeDescription, Storage>&, uint32_t, uint32_t)> nodeEdgesInsertion)
     {
-        auto nodeIdsMapping = objects::types::U32U32Map{};
-        auto mesh = Mesh<NodeDescription, EdgeDescription>{};
+        auto nodeIdsMapping = objects::types::U32U32Map{m_mesh.resource()};
+        auto mesh = Mesh<NodeDescription, EdgeDescription, Storage>{m_mesh.resource()};
 
         auto nodesNumber = get_size_t(str);
         auto edgesNumber = get_size_t(str);
+        if (!nodesNumber || !edgesNumber)
+        {
+            throw std::invalid_argument{"At byte " + std::to_string(get_offset(str)) + ". Missing number of nodes or edges"};
+        }
 
         for (auto i = 0u; i < *nodesNumber; ++i)
         {
+            const auto offset = get_offset(str);
             const auto nodeId = get_size_t(str);
             const auto nodeDesc = get_string(str);
 
             if (!nodeId || !nodeDesc)
             {
                 auto result = std::stringstream{};
-                result << "At node element " << i << '/' << *nodesNumber << ". ID = "
+                result << "At byte " << offset << ", node element " << i << '/' << *nodesNumber << ". ID = "
                        << (!nodeId ? std::string{"'missing node ID'"} : std::to_string(*nodeId))
                        << ", DESCRIPTION = "
-                       << (!nodeDesc ? std::string{"'missing node description'"} : *nodeDesc);
+                       << (!nodeDesc ? std::string{"'missing node description'"} : std::string{*nodeDesc});
                 throw std::invalid_argument{result.str()};
             }
             else
             {
-                auto newNodeId = nodeInsertion(mesh, NodeDescription{*nodeDesc});
+                auto newNodeId = nodeInsertion(mesh, NodeDescription{std::string{*nodeDesc}});
                 nodeIdsMapping.insert({*nodeId, newNodeId});
             }
         }
 
         for (auto i = 0u; i < *edgesNumber; ++i)
         {
+            const auto offset = get_offset(str);
             const auto edgeId = get_size_t(str);
             const auto edgeFirstNodeId = get_size_t(str);
             const auto edgeSecondNodeId = get_size_t(str);
@@ -156,14 +672,14 @@ private:
             if (!edgeId || !edgeFirstNodeId || !edgeSecondNodeId || !edgeDesc)
             {
                 auto result = std::stringstream{};
-                result << "At edge element " << i << '/' << *edgesNumber << ". ID = "
+                result << "At byte " << offset << ", edge element " << i << '/' << *edgesNumber << ". ID = "
                        << (!edgeId ? std::string{"'missing edge ID'"} : std::to_string(*edgeId))
                        << ", FIRST ENDPOINT = "
                        << (!edgeFirstNodeId ? std::string{"'missing first endpoint id'"} : std::to_string(*edgeFirstNodeId))
                        << ", SECOND ENDPOINT = "
                        << (!edgeSecondNodeId ? std::string{"'missing second endpoint id'"} : std::to_string(*edgeSecondNodeId))
                        << ", DESCRIPTION = "
-                       << (!edgeDesc ? std::string{"'missing edge description'"} : *edgeDesc);
+                       << (!edgeDesc ? std::string{"'missing edge description'"} : std::string{*edgeDesc});
                 throw std::invalid_argument{result.str()};
             }
             else
@@ -174,7 +690,7 @@ private:
                 if (firstNodeId == 0 || secondNodeId == 0)
                 {
                     auto result = std::stringstream{};
-                    result << "At edge element " << i << '/' << *edgesNumber << ". ID = "
+                    result << "At byte " << offset << ", edge element " << i << '/' << *edgesNumber << ". ID = "
                            << std::to_string(*edgeId) << ", FIRST ENDPOINT = "
                            << std::to_string(*edgeFirstNodeId) << ", SECOND ENDPOINT = "
                            << std::to_string(*edgeSecondNodeId) << ", DESCRIPTION = " << *edgeDesc
@@ -186,88 +702,310 @@ private:
                     throw std::invalid_argument{result.str()};
                 }
 
-                auto newEdgeId = edgeInsertion(mesh, firstNodeId, secondNodeId, EdgeDescription{*edgeDesc});
+                auto newEdgeId = edgeInsertion(mesh, firstNodeId, secondNodeId, EdgeDescription{std::string{*edgeDesc}});
                 nodeEdgesInsertion(mesh, firstNodeId, newEdgeId);
                 nodeEdgesInsertion(mesh, secondNodeId, newEdgeId);
             }
         }
 
-        std::swap(m_mesh, mesh);
+        adopt(m_mesh, mesh);
     }
 
-    void skipWhiteChars(StringFile& str)
+    /** Nodes and edges keep their IDs from the pack. */
+    void mesh_load(Mesh<NodeDescription, EdgeDescription, Storage>& m_mesh, const MappedView& view)
     {
-        if (str.cursor >= str.data.size())
-            return;
+        auto mesh = Mesh<NodeDescription, EdgeDescription, Storage>{m_mesh.resource()};
+
+        for (auto i = 0u; i < view.size(); ++i)
+        {
+            if (mesh.insertNode(NodeDescription{std::string{view.value(i)}}, view.id(i)) == 0)
+            {
+                throw std::invalid_argument{"At node element " + std::to_string(i) + '/' + std::to_string(view.size()) +
+                                            ". ID = " + std::to_string(view.id(i)) + " is not a valid node ID"};
+            }
+        }
+
+        for (auto i = 0u; i < view.edgeCount(); ++i)
+        {
+            const auto [firstNodeId, secondNodeId] = view.endpoints(i);
+            const auto edgeId = view.edgeId(i);
+            auto error = std::string{};
+            if (view.index(firstNodeId) == MappedView::NO_INDEX || view.index(secondNodeId) == MappedView::NO_INDEX)
+            {
+                error = "endpoint missing from node table";
+            }
+            else if (firstNodeId == secondNodeId || mesh.edgeBetween(firstNodeId, secondNodeId) != 0)
+            {
+                error = "loop or repeated edge";
+            }
+            else if (mesh.insertEdge({firstNodeId, secondNodeId}, EdgeDescription{std::string{view.edgeValue(i)}}, edgeId) == 0)
+            {
+                error = "not a valid edge ID";
+            }
+
+            if (!error.empty())
+            {
+                auto result = std::stringstream{};
+                result << "At edge element " << i << '/' << view.edgeCount() << ". ID = " << edgeId
+                       << ", FIRST ENDPOINT = " << firstNodeId
+                       << ", SECOND ENDPOINT = " << secondNodeId
+                       << ", " << error;
+                throw std::invalid_argument{result.str()};
+            }
+            mesh.m_nodes[firstNodeId].edges().insert(edgeId);
+            mesh.m_nodes[secondNodeId].edges().insert(edgeId);
+        }
 
-        while (str.data[str.cursor] == '\n' ||
-               str.data[str.cursor] == '\t' ||
-               str.data[str.cursor] == ' '  ||
-               str.data[str.cursor] == ';')
-            ++str.cursor;
+        mesh.restoreIds();
+        adopt(m_mesh, mesh);
     }
 
-    std::optional<std::size_t> get_size_t(StringFile& str)
+    template <typename Policy>
+    void mesh_load(Mesh<NodeDescription, EdgeDescription, Storage>& m_mesh, const MappedFile& file, Policy policy)
     {
-        skipWhiteChars(str);
-        const auto bPos = str.cursor;
-        if (bPos >= str.data.size())
+        auto header = CompactHeader{};
+        if (file.size() < sizeof(header))
         {
-            return {};
+            throw std::invalid_argument{"Compact pack is too small for its header"};
         }
+        std::memcpy(&header, file.data(), sizeof(header));
 
-        while (isdigit(str.data[str.cursor]))
-            ++str.cursor;
+        const auto bodySize = file.size() - sizeof(header);
+        if (!header.valid() || header.nodeCount > bodySize || header.edgeCount > bodySize || header.wordCount > bodySize)
+        {
+            throw std::invalid_argument{"Compact pack header is damaged"};
+        }
 
-        const auto number = std::string(&str.data[bPos], str.cursor - bPos);
-        return static_cast<std::size_t>(std::atoll(number.c_str()));
-    }
+        const auto wordBlocks = header.wordBlocks();
+        const auto nodeBlocks = header.nodeBlocks();
+        const auto blockCount = wordBlocks + nodeBlocks + header.edgeBlocks();
+        if (blockCount > bodySize / sizeof(uint64_t) || header.dataSize != bodySize - blockCount * sizeof(uint64_t))
+        {
+            throw std::invalid_argument{"Compact pack size does not match its header"};
+        }
 
-    std::optional<std::size_t> get_size_t(std::ifstream& str)
-    {
-        auto result = std::uint32_t{};
-        str.read(reinterpret_cast<char*>(&result), sizeof(result));
-        return result;
+        auto checksum = PackChecksum{};
+        checksum.update(file.data() + sizeof(header), bodySize);
+        if (checksum.value() != header.checksum)
+        {
+            throw std::invalid_argument{"Compact pack is damaged, checksum does not match"};
+        }
+
+        const auto* ends = reinterpret_cast<const uint64_t*>(file.data() + sizeof(header));
+        const auto* data = file.data() + sizeof(header) + blockCount * sizeof(uint64_t);
+        for (auto block = std::size_t{0}; block < blockCount; ++block)
+        {
+            if ((block != 0 && ends[block] < ends[block - 1]) || ends[block] > header.dataSize)
+            {
+                throw std::invalid_argument{"Compact pack block table is damaged"};
+            }
+        }
+
+        auto words = std::vector<std::string_view>(header.wordCount);
+        auto nodeWords = std::vector<uint32_t>(header.nodeCount);
+        auto edges = std::vector<CompactEdge>(header.edgeCount);
+        const auto parts = partCount(policy, header.wordCount + header.nodeCount + header.edgeCount);
+        forEachPart(std::min<std::size_t>(parts, blockCount), blockCount, [&](std::size_t, std::size_t first, std::size_t last)
+        {
+            for (auto block = first; block < last; ++block)
+            {
+                const auto* cursor = data + (block == 0 ? 0 : ends[block - 1]);
+                const auto* end = data + ends[block];
+                auto valid = true;
+                const auto read = [&](uint64_t& value, uint64_t bound)
+                {
+                    valid = valid && getVarint(cursor, end, value) && value < bound;
+                    return valid;
+                };
+
+                if (block < wordBlocks)
+                {
+                    forEachInBlock(block, header.blockSize, words.size(), [&](std::size_t i)
+                    {
+                        auto size = uint64_t{};
+                        if (read(size, header.dataSize + 1) && size <= static_cast<uint64_t>(end - cursor))
+                        {
+                            words[i] = std::string_view{cursor, size};
+                            cursor += size;
+                        }
+                        else
+                        {
+                            valid = false;
+                        }
+                    });
+                }
+                else if (block < wordBlocks + nodeBlocks)
+                {
+                    forEachInBlock(block - wordBlocks, header.blockSize, nodeWords.size(), [&](std::size_t i)
+                    {
+                        auto word = uint64_t{};
+                        read(word, header.wordCount);
+                        nodeWords[i] = static_cast<uint32_t>(word);
+                    });
+                }
+                else
+                {
+                    auto previous = uint64_t{0};
+                    forEachInBlock(block - wordBlocks - nodeBlocks, header.blockSize, edges.size(), [&](std::size_t i)
+                    {
+                        auto delta = uint64_t{};
+                        auto span = uint64_t{};
+                        auto word = uint64_t{};
+                        if (read(delta, header.nodeCount - previous) &&
+                            read(span, header.nodeCount - previous - delta) &&
+                            read(word, header.wordCount))
+                        {
+                            previous += delta;
+                            edges[i] = CompactEdge{static_cast<uint32_t>(previous),
+                                                   static_cast<uint32_t>(previous + span),
+                                                   static_cast<uint32_t>(word)};
+                        }
+                    });
+                }
+
+                if (!valid || cursor != end)
+                {
+                    throw std::invalid_argument{"Compact pack block " + std::to_string(block) + " is damaged"};
+                }
+            }
+        });
+
+        auto mesh = Mesh<NodeDescription, EdgeDescription, Storage>{m_mesh.resource()};
+        auto nodeIdsMapping = std::vector<uint32_t>{};
+        nodeIdsMapping.reserve(nodeWords.size());
+        for (const auto word : nodeWords)
+        {
+            nodeIdsMapping.push_back(mesh.insertNode(NodeDescription{std::string{words[word]}}));
+        }
+        for (auto i = std::size_t{0}; i < edges.size(); ++i)
+        {
+            const auto& edge = edges[i];
+            if (edge.lower == edge.higher ||
+                (i != 0 && std::tie(edge.lower, edge.higher) <= std::tie(edges[i - 1].lower, edges[i - 1].higher)))
+            {
+                throw std::invalid_argument{"Compact pack edge " + std::to_string(i) + " is a loop or repeats"};
+            }
+
+            const auto firstNodeId = nodeIdsMapping[edge.lower];
+            const auto secondNodeId = nodeIdsMapping[edge.higher];
+            const auto newEdgeId = mesh.insertEdge({firstNodeId, secondNodeId}, EdgeDescription{std::string{words[edge.word]}});
+            mesh.m_nodes[firstNodeId].edges().insert(newEdgeId);
+            mesh.m_nodes[secondNodeId].edges().insert(newEdgeId);
+        }
+
+        adopt(m_mesh, mesh);
     }
 
-    std::optional<std::string> get_string(StringFile& str)
+    /**
+     * Carries enabled indices over to freshly loaded mesh and replaces the old
+     * one with it, a change log attached to the old mesh records the swap.
+     * Version counters of the result are above both, so nothing cached for
+     * the old mesh is taken as current.
+     */
+    void adopt(Mesh<NodeDescription, EdgeDescription, Storage>& m_mesh,
+               Mesh<NodeDescription, EdgeDescription, Storage>& mesh)
     {
-        skipWhiteChars(str);
-        const auto bPos = str.cursor;
-        if (bPos >= str.data.size())
+        if (m_mesh.hasConnectivityIndex())
         {
-            return {};
+            mesh.enableConnectivityIndex();
         }
-        else if (str.data[bPos] != '"')
+        if (m_mesh.hasLandmarks())
         {
-            return {};
+            mesh.enableLandmarks(m_mesh.m_landmarks->count());
         }
+        if (m_mesh.hasPathCache())
+        {
+            mesh.enablePathCache(m_mesh.m_pathCache->capacity());
+        }
+        if (m_mesh.hasValueIndex())
+        {
+            mesh.setValueIndex(m_mesh.m_valueIndex->fresh(mesh.resource()));
+        }
+
+        mesh.m_topologyVersion = m_mesh.m_topologyVersion + mesh.m_topologyVersion + 1;
+        mesh.m_descriptionVersion = m_mesh.m_descriptionVersion + mesh.m_descriptionVersion + 1;
 
-        while (str.data[str.cursor] != '\0')
+        auto* changeLog = std::exchange(m_mesh.m_changeLog, nullptr);
+        std::swap(m_mesh, mesh);
+        if (changeLog)
         {
-            if (str.data[str.cursor] == '"' && str.data[str.cursor + 1] == '\n')
+            m_mesh.m_changeLog = changeLog;
+            changeLog->clear();
+            for (const auto& node : m_mesh.m_nodes)
             {
-                ++str.cursor;
-                break;
+                changeLog->insertNode(node.first, node.second.value());
             }
-            ++str.cursor;
+            for (const auto& edge : m_mesh.m_edges)
+            {
+                changeLog->insertEdge(edge.first, edge.second.nodes().first, edge.second.nodes().second, edge.second.value());
+            }
+            changeLog->operationEnd();
+        }
+    }
+
+    uint64_t get_offset(TextReader& str)
+    {
+        return str.tokenOffset();
+    }
+
+    uint64_t get_offset(std::ifstream& str)
+    {
+        return static_cast<uint64_t>(str.tellg());
+    }
+
+    std::optional<std::size_t> get_size_t(TextReader& str)
+    {
+        return str.number();
+    }
+
+    std::optional<std::size_t> get_size_t(std::ifstream& str)
+    {
+        auto result = std::uint32_t{};
+        if (!str.read(reinterpret_cast<char*>(&result), sizeof(result)))
+        {
+            return {};
         }
+        return result;
+    }
 
-        return std::string(&str.data[bPos + 1], str.cursor - bPos - 2);
+    std::optional<std::string_view> get_string(TextReader& str)
+    {
+        return str.quoted();
     }
 
     std::optional<std::string> get_string(std::ifstream& str)
     {
         auto size = std::uint32_t{};
-        auto result = std::string{};
-        result.reserve(size);
-        str.read(reinterpret_cast<char*>(&size), sizeof(size));
-        str.read(reinterpret_cast<char*>(&result), size);
+        if (!str.read(reinterpret_cast<char*>(&size), sizeof(size)))
+        {
+            return {};
+        }
+
+        auto result = std::string(size, '\0');
+        if (!str.read(result.data(), size))
+        {
+            return {};
+        }
         return result;
     }
 
+    template <typename Description>
+    static void append(std::string& strings, const Description& description)
+    {
+        if constexpr (std::is_convertible_v<const Description&, std::string_view>)
+        {
+            strings.append(std::string_view{description});
+        }
+        else
+        {
+            auto result = std::ostringstream{};
+            result << description;
+            strings.append(result.str());
+        }
+    }
+
 private:
-    Mesh<NodeDescription, EdgeDescription>& m_mesh;
+    Mesh<NodeDescription, EdgeDescription, Storage>& m_mesh;
 };
 
 }  // namespace utils
@@ -0,0 +1,177 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <cstring>
+#include <inttypes.h>
+#include <optional>
+#include <type_traits>
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Binary mesh file, version 2. All integers are in host byte order and every
+ * section starts at a multiple of 8 bytes, so a mapped file could be read in
+ * place:
+ *     PackHeader
+ *     PackNode[nodeCount]              sorted by node ID
+ *     uint32_t[arcCount]               neighbour node indices, CSR of the nodes
+ *     uint32_t[arcCount]               edge ID of every neighbour
+ *     PackEdge[edgeCount]              sorted by edge ID
+ *     char[stringsSize]                descriptions
+ * Both uint32_t arrays are zero padded to a multiple of 8 bytes. The checksum
+ * covers everything after the header.
+ */
+struct PackHeader
+{
+    static constexpr char MAGIC[8] = {'M', 'E', 'S', 'H', 'P', 'A', 'C', 'K'};
+    static constexpr uint32_t VERSION = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t nodeCount;
+    uint64_t arcCount;
+    uint64_t edgeCount;
+    uint64_t stringsSize;
+    uint64_t checksum;
+    uint64_t reserved;
+
+    bool valid() const
+    {
+        return std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 &&
+               version == VERSION &&
+               headerSize == sizeof(PackHeader);
+    }
+};
+
+struct PackNode
+{
+    uint32_t id;
+    uint32_t descriptionSize;
+    uint64_t descriptionOffset;
+    uint64_t firstArc;
+};
+
+struct PackEdge
+{
+    uint32_t id;
+    uint32_t firstNodeId;
+    uint32_t secondNodeId;
+    uint32_t descriptionSize;
+    uint64_t descriptionOffset;
+};
+
+static_assert(sizeof(PackHeader) == 64 && std::is_trivially_copyable_v<PackHeader>);
+static_assert(sizeof(PackNode) == 24 && std::is_trivially_copyable_v<PackNode>);
+static_assert(sizeof(PackEdge) == 24 && std::is_trivially_copyable_v<PackEdge>);
+
+/** Byte offsets of the sections of a pack file. */
+struct PackLayout
+{
+    uint64_t nodes;
+    uint64_t neighbours;
+    uint64_t edgeIds;
+    uint64_t edges;
+    uint64_t strings;
+    uint64_t end;
+
+    static uint64_t padded(uint64_t size) { return (size + 7) & ~uint64_t{7}; }
+
+    /** Empty when the header counts do not fit into a file of given size. */
+    static std::optional<PackLayout> of(const PackHeader& header, uint64_t fileSize)
+    {
+        if (header.nodeCount > fileSize || header.arcCount > fileSize ||
+            header.edgeCount > fileSize || header.stringsSize > fileSize)
+        {
+            return {};
+        }
+
+        auto layout = PackLayout{};
+        layout.nodes = sizeof(PackHeader);
+        layout.neighbours = layout.nodes + header.nodeCount * sizeof(PackNode);
+        layout.edgeIds = layout.neighbours + padded(header.arcCount * sizeof(uint32_t));
+        layout.edges = layout.edgeIds + padded(header.arcCount * sizeof(uint32_t));
+        layout.strings = layout.edges + header.edgeCount * sizeof(PackEdge);
+        layout.end = layout.strings + header.stringsSize;
+        return layout;
+    }
+};
+
+/**
+ * Checksum of pack file contents. Bytes are consumed a word at a time, each
+ * step is a bijection of the state, so any single changed word is detected.
+ * Data may be fed in pieces of any size.
+ */
+class PackChecksum
+{
+public:
+    explicit PackChecksum()
+        : m_state{0xcbf29ce484222325ull}
+        , m_tail{}
+        , m_tailSize{0}
+        , m_size{0}
+    {}
+
+    void update(const char* data, std::size_t size)
+    {
+        m_size += size;
+        while (m_tailSize != 0 && size != 0)
+        {
+            m_tail[m_tailSize++] = *data++;
+            --size;
+            if (m_tailSize == sizeof(uint64_t))
+            {
+                mix(m_tail);
+                m_tailSize = 0;
+            }
+        }
+
+        for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t))
+        {
+            mix(data);
+        }
+
+        for (; size != 0; --size)
+        {
+            m_tail[m_tailSize++] = *data++;
+        }
+    }
+
+    uint64_t value() const
+    {
+        auto result = *this;
+        std::memset(result.m_tail + m_tailSize, 0, sizeof(uint64_t) - m_tailSize);
+        result.mix(result.m_tail);
+        result.mix(m_size);
+        return result.m_state;
+    }
+
+private:
+    void mix(const char* bytes)
+    {
+        auto word = uint64_t{};
+        std::memcpy(&word, bytes, sizeof(word));
+        mix(word);
+    }
+
+    void mix(uint64_t word)
+    {
+        m_state = (m_state ^ word) * 0x100000001b3ull;
+        m_state = (m_state << 31) | (m_state >> 33);
+    }
+
+private:
+    uint64_t m_state;
+    char m_tail[sizeof(uint64_t)];
+    std::size_t m_tailSize;
+    uint64_t m_size;
+};
+
+}  // namespace utils
+}  // namespace mesh
@@ -0,0 +1,174 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <inttypes.h>
+#include <limits>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Min pairing heap over dense item indices with O(1) push and decrease-key
+ * and O(log n) amortized pop. Item slots are preallocated for the whole
+ * index range and stamped, so reset() between searches is O(1).
+ */
+class PairingHeap
+{
+    static constexpr auto NIL = std::numeric_limits<uint32_t>::max();
+
+    struct Item
+    {
+        double key;
+        uint32_t child;
+        uint32_t sibling;
+        uint32_t previous;
+    };
+
+public:
+    explicit PairingHeap(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_root{NIL}
+        , m_stamp{0}
+        , m_items{resource}
+        , m_stamps{resource}
+        , m_pairs{resource}
+    {}
+
+    void reset(uint32_t indexBound)
+    {
+        if (m_items.size() < indexBound)
+        {
+            m_items.resize(indexBound);
+            m_stamps.resize(indexBound, 0);
+            m_pairs.reserve(indexBound);
+        }
+
+        m_root = NIL;
+        if (++m_stamp == 0)
+        {
+            std::fill(m_stamps.begin(), m_stamps.end(), 0);
+            m_stamp = 1;
+        }
+    }
+
+    bool empty() const { return m_root == NIL; }
+    bool contains(uint32_t index) const { return m_stamps[index] == m_stamp; }
+    uint32_t top() const { return m_root; }
+    double topKey() const { return m_items[m_root].key; }
+
+    void push(uint32_t index, double key)
+    {
+        m_items[index] = Item{key, NIL, NIL, NIL};
+        m_stamps[index] = m_stamp;
+        m_root = link(m_root, index);
+    }
+
+    void decrease(uint32_t index, double key)
+    {
+        auto& item = m_items[index];
+        item.key = key;
+        if (index == m_root)
+        {
+            return;
+        }
+
+        detach(index);
+        m_root = link(m_root, index);
+    }
+
+    uint32_t pop()
+    {
+        const auto result = m_root;
+        m_stamps[result] = m_stamp - 1;
+
+        m_pairs.clear();
+        for (auto child = m_items[result].child; child != NIL;)
+        {
+            const auto next = m_items[child].sibling;
+            m_items[child].sibling = NIL;
+            m_items[child].previous = NIL;
+            m_pairs.push_back(child);
+            child = next;
+        }
+
+        auto pairsCount = std::size_t{0};
+        for (auto i = std::size_t{0}; i < m_pairs.size(); i += 2)
+        {
+            m_pairs[pairsCount++] = (i + 1 < m_pairs.size()) ? link(m_pairs[i], m_pairs[i + 1]) : m_pairs[i];
+        }
+
+        m_root = NIL;
+        while (pairsCount != 0)
+        {
+            m_root = link(m_pairs[--pairsCount], m_root);
+        }
+        return result;
+    }
+
+private:
+    uint32_t link(uint32_t first, uint32_t second)
+    {
+        if (first == NIL)
+        {
+            return second;
+        }
+        else if (second == NIL)
+        {
+            return first;
+        }
+        else if (m_items[second].key < m_items[first].key)
+        {
+            std::swap(first, second);
+        }
+
+        auto& parent = m_items[first];
+        auto& child = m_items[second];
+        child.sibling = parent.child;
+        child.previous = first;
+        if (parent.child != NIL)
+        {
+            m_items[parent.child].previous = second;
+        }
+        parent.child = second;
+        return first;
+    }
+
+    void detach(uint32_t index)
+    {
+        auto& item = m_items[index];
+        auto& previous = m_items[item.previous];
+        if (previous.child == index)
+        {
+            previous.child = item.sibling;
+        }
+        else
+        {
+            previous.sibling = item.sibling;
+        }
+
+        if (item.sibling != NIL)
+        {
+            m_items[item.sibling].previous = item.previous;
+        }
+        item.sibling = NIL;
+        item.previous = NIL;
+    }
+
+private:
+    uint32_t m_root;
+    uint32_t m_stamp;
+    std::pmr::vector<Item> m_items;
+    std::pmr::vector<uint32_t> m_stamps;
+    std::pmr::vector<uint32_t> m_pairs;
+};
+
+}  // namespace utils
+}  // namespace mesh
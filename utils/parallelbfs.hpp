@@ -0,0 +1,420 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <inttypes.h>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "utils/execution.hpp"
+#include "utils/threadpool.hpp"
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Level synchronous, direction optimizing breadth first search (Beamer).
+ * Small frontiers are expanded top-down, once the frontier touches a big
+ * share of unexplored arcs whole levels are found bottom-up by letting every
+ * unvisited vertex look for a parent in the frontier. Visited vertices are
+ * kept in an atomic bitset indexed by dense vertex indices, levels bigger than
+ * GRAIN are split between the workers of the shared pool. Buffers are kept
+ * between searches and grow only with the graph, graphs not bigger than
+ * GRAIN are searched without the pool. Per-worker buffers grow on worker
+ * threads, so they do not use given memory resource, which may be
+ * unsynchronized.
+ *
+ * Graph, given to every search, is an undirected adjacency adapter providing:
+ *     uint32_t indexBound() const;            // dense indices are below it
+ *     uint32_t index(uint32_t vertex) const;
+ *     std::size_t degree(uint32_t vertex) const;
+ *     std::size_t arcCount() const;           // sum of all degrees
+ *     bool forEachNeighbour(uint32_t vertex, F f) const;   // stops when f returns true
+ *     void forEachVertex(F f) const;
+ */
+class ParallelBfs
+{
+    static constexpr std::size_t GRAIN = 1024;
+    static constexpr std::size_t ALPHA = 14;
+    static constexpr std::size_t BETA = 24;
+
+    struct alignas(64) Local
+    {
+        explicit Local(std::pmr::memory_resource* resource)
+            : vertices{resource}
+            , arcs{0}
+            , found{false}
+        {}
+
+        std::pmr::vector<uint32_t> vertices;
+        std::size_t arcs;
+        bool found;
+    };
+
+public:
+    explicit ParallelBfs(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_resource{resource}
+        , m_visited{resource}
+        , m_inFrontier{resource}
+        , m_vertices{resource}
+        , m_local{}
+    {}
+
+    std::pmr::memory_resource* resource() const { return m_resource; }
+
+    /** Vertices reachable from source, level by level, source first. */
+    template <typename Graph>
+    std::pmr::vector<uint32_t> reach(const Graph& graph, uint32_t source)
+    {
+        prepare(graph);
+        auto reached = std::pmr::vector<uint32_t>{m_resource};
+        search(graph, source, std::nullopt, reached);
+        forget(graph, reached);
+        return reached;
+    }
+
+    template <typename Graph>
+    bool reachable(const Graph& graph, uint32_t source, uint32_t target)
+    {
+        if (source == target)
+        {
+            return true;
+        }
+
+        prepare(graph);
+        auto reached = std::pmr::vector<uint32_t>{m_resource};
+        const auto found = search(graph, source, target, reached);
+        forget(graph, reached);
+        return found;
+    }
+
+    /**
+     * Labels every vertex with its component number, components are
+     * numbered from 1. Returns number of components.
+     */
+    template <typename Graph, typename Assign>
+    uint32_t components(const Graph& graph, Assign&& assign)
+    {
+        prepare(graph);
+        collectVertices(graph);
+
+        auto label = 0u;
+        auto reached = std::pmr::vector<uint32_t>{m_resource};
+        for (const auto vertex : m_vertices)
+        {
+            if (isVisited(graph.index(vertex)))
+            {
+                continue;
+            }
+
+            ++label;
+            reached.clear();
+            search(graph, vertex, std::nullopt, reached);
+            for (const auto reachedVertex : reached)
+            {
+                assign(reachedVertex, label);
+            }
+        }
+
+        std::fill(m_visited.begin(), m_visited.end(), 0);
+        return label;
+    }
+
+private:
+    /**
+     * Vertex list may belong to another graph, the bitset is clear between
+     * searches and only grows, as do per-worker buffers.
+     */
+    template <typename Graph>
+    void prepare(const Graph& graph)
+    {
+        m_vertices.clear();
+        const auto workers = graph.indexBound() > GRAIN ? sharedPool().size() : 1u;
+        while (m_local.size() < workers)
+        {
+            m_local.emplace_back(std::pmr::new_delete_resource());
+        }
+
+        const auto words = (std::size_t{graph.indexBound()} + 63) / 64;
+        if (words > m_visited.size())
+        {
+            auto visited = std::pmr::vector<std::atomic<uint64_t>>(words, m_resource);
+            m_visited.swap(visited);
+        }
+    }
+
+    template <typename Graph>
+    bool search(const Graph& graph, uint32_t source, std::optional<uint32_t> target, std::pmr::vector<uint32_t>& reached)
+    {
+        claim(graph.index(source));
+        reached.push_back(source);
+
+        auto frontier = std::pmr::vector<uint32_t>{m_resource};
+        frontier.push_back(source);
+        auto frontierArcs = graph.degree(source);
+        auto unexploredArcs = graph.arcCount() - std::min(frontierArcs, graph.arcCount());
+        auto topDown = true;
+
+        while (!frontier.empty())
+        {
+            if (topDown && frontierArcs > unexploredArcs / ALPHA)
+            {
+                collectVertices(graph);
+                topDown = false;
+            }
+            else if (!topDown && frontier.size() < m_vertices.size() / BETA)
+            {
+                topDown = true;
+            }
+
+            const auto found = topDown ? topDownStep(graph, frontier, target) : bottomUpStep(graph, frontier, target);
+
+            frontier.clear();
+            frontierArcs = 0;
+            for (auto& local : m_local)
+            {
+                frontier.insert(frontier.end(), local.vertices.begin(), local.vertices.end());
+                frontierArcs += local.arcs;
+            }
+            reached.insert(reached.end(), frontier.begin(), frontier.end());
+            unexploredArcs -= std::min(frontierArcs, unexploredArcs);
+
+            if (found)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Graph>
+    bool topDownStep(const Graph& graph, const std::pmr::vector<uint32_t>& frontier, std::optional<uint32_t> target)
+    {
+        parallelFor(frontier.size(), [&](Local& local, std::size_t first, std::size_t last)
+        {
+            for (auto i = first; i < last && !local.found; ++i)
+            {
+                graph.forEachNeighbour(frontier[i], [&](uint32_t next)
+                {
+                    if (!claim(graph.index(next)))
+                    {
+                        return false;
+                    }
+                    local.vertices.push_back(next);
+                    local.arcs += graph.degree(next);
+                    local.found = (next == target);
+                    return local.found;
+                });
+            }
+        });
+        return anyFound();
+    }
+
+    template <typename Graph>
+    bool bottomUpStep(const Graph& graph, const std::pmr::vector<uint32_t>& frontier, std::optional<uint32_t> target)
+    {
+        m_inFrontier.assign(m_visited.size(), 0);
+        for (const auto vertex : frontier)
+        {
+            const auto vertexIndex = graph.index(vertex);
+            m_inFrontier[vertexIndex / 64] |= bit(vertexIndex);
+        }
+
+        parallelFor(m_vertices.size(), [&](Local& local, std::size_t first, std::size_t last)
+        {
+            for (auto i = first; i < last; ++i)
+            {
+                const auto vertex = m_vertices[i];
+                const auto vertexIndex = graph.index(vertex);
+                if (isVisited(vertexIndex))
+                {
+                    continue;
+                }
+
+                const auto hasParent = graph.forEachNeighbour(vertex, [&](uint32_t next)
+                {
+                    const auto nextIndex = graph.index(next);
+                    return (m_inFrontier[nextIndex / 64] & bit(nextIndex)) != 0;
+                });
+
+                if (hasParent)
+                {
+                    claim(vertexIndex);
+                    local.vertices.push_back(vertex);
+                    local.arcs += graph.degree(vertex);
+                    local.found = local.found || (vertex == target);
+                }
+            }
+        });
+        return anyFound();
+    }
+
+    template <typename Function>
+    void parallelFor(std::size_t count, Function&& function)
+    {
+        for (auto& local : m_local)
+        {
+            local.vertices.clear();
+            local.arcs = 0;
+            local.found = false;
+        }
+
+        const auto parts = std::clamp<std::size_t>((count + GRAIN - 1) / GRAIN, 1, m_local.size());
+        forEachPart(parts, count, [&](std::size_t part, std::size_t first, std::size_t last)
+        {
+            function(m_local[part], first, last);
+        });
+    }
+
+    bool anyFound() const
+    {
+        return std::any_of(m_local.cbegin(), m_local.cend(), [](const auto& local) { return local.found; });
+    }
+
+    template <typename Graph>
+    void collectVertices(const Graph& graph)
+    {
+        if (m_vertices.empty())
+        {
+            graph.forEachVertex([this](uint32_t vertex) { m_vertices.push_back(vertex); });
+        }
+    }
+
+    template <typename Graph>
+    void forget(const Graph& graph, const std::pmr::vector<uint32_t>& reached)
+    {
+        if (reached.size() > m_visited.size())
+        {
+            std::fill(m_visited.begin(), m_visited.end(), 0);
+            return;
+        }
+
+        for (const auto vertex : reached)
+        {
+            m_visited[graph.index(vertex) / 64].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    bool claim(uint32_t vertexIndex)
+    {
+        auto& word = m_visited[vertexIndex / 64];
+        const auto mask = bit(vertexIndex);
+        if (word.load(std::memory_order_relaxed) & mask)
+        {
+            return false;
+        }
+        return (word.fetch_or(mask, std::memory_order_relaxed) & mask) == 0;
+    }
+
+    bool isVisited(uint32_t vertexIndex) const
+    {
+        return (m_visited[vertexIndex / 64].load(std::memory_order_relaxed) & bit(vertexIndex)) != 0;
+    }
+
+    static uint64_t bit(uint32_t vertexIndex)
+    {
+        return uint64_t{1} << (vertexIndex % 64);
+    }
+
+private:
+    std::pmr::memory_resource* m_resource;
+    std::pmr::vector<std::atomic<uint64_t>> m_visited;
+    std::pmr::vector<uint64_t> m_inFrontier;
+    std::pmr::vector<uint32_t> m_vertices;
+    std::vector<Local> m_local;
+};
+
+/**
+ * ParallelBfs kept by an owner with const queries (a mesh or a view), so its
+ * buffers are reused between them. It is created by the first search, one
+ * started while the kept one is in use by another thread runs on a
+ * temporary one.
+ */
+class ParallelBfsCache
+{
+public:
+    explicit ParallelBfsCache(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_resource{resource}
+        , m_state{nullptr}
+    {}
+
+    ParallelBfsCache(const ParallelBfsCache&) = delete;
+    ParallelBfsCache& operator=(const ParallelBfsCache&) = delete;
+
+    ParallelBfsCache(ParallelBfsCache&& other) noexcept
+        : m_resource{other.m_resource}
+        , m_state{other.m_state.exchange(nullptr)}
+    {}
+
+    ParallelBfsCache& operator=(ParallelBfsCache&& other) noexcept
+    {
+        if (this != &other)
+        {
+            delete m_state.exchange(other.m_state.exchange(nullptr));
+            m_resource = other.m_resource;
+        }
+        return *this;
+    }
+
+    ~ParallelBfsCache()
+    {
+        delete m_state.load();
+    }
+
+    /** Returns function(bfs). */
+    template <typename Function>
+    auto use(Function&& function) const
+    {
+        auto* state = m_state.load(std::memory_order_acquire);
+        if (state == nullptr)
+        {
+            auto created = std::make_unique<State>(m_resource);
+            if (m_state.compare_exchange_strong(state, created.get(), std::memory_order_acq_rel))
+            {
+                state = created.release();
+            }
+        }
+
+        if (state->busy.exchange(true, std::memory_order_acquire))
+        {
+            auto bfs = ParallelBfs{m_resource};
+            return function(bfs);
+        }
+
+        struct Release
+        {
+            ~Release() { busy.store(false, std::memory_order_release); }
+            std::atomic<bool>& busy;
+        };
+        const auto release = Release{state->busy};
+        return function(state->bfs);
+    }
+
+private:
+    struct State
+    {
+        explicit State(std::pmr::memory_resource* resource)
+            : busy{false}
+            , bfs{resource}
+        {}
+
+        std::atomic<bool> busy;
+        ParallelBfs bfs;
+    };
+
+private:
+    std::pmr::memory_resource* m_resource;
+    mutable std::atomic<State*> m_state;
+};
+
+}  // namespace utils
+}  // namespace mesh
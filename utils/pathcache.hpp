@@ -0,0 +1,153 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <functional>
+#include <inttypes.h>
+#include <iterator>
+#include <list>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Least recently used cache of path query results. Every entry remembers
+ * the mesh epoch it was computed at, an entry from another epoch is dropped
+ * on lookup, so mutations invalidate the cache without touching it. Memory
+ * is bounded by capacity, counted in stored node IDs plus one per entry.
+ */
+class PathCache
+{
+public:
+    enum class Kind : uint64_t
+    {
+        PATH,
+        SEQUENCE
+    };
+
+    struct Stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+private:
+    struct Key
+    {
+        Kind kind;
+        uint64_t value;
+
+        bool operator==(const Key& other) const { return kind == other.kind && value == other.value; }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const
+        {
+            return std::hash<uint64_t>{}(key.value * 0x9E3779B97F4A7C15ull + static_cast<uint64_t>(key.kind));
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        uint64_t epoch;
+        std::pmr::vector<uint32_t> ids;
+    };
+
+    using Entries = std::pmr::list<Entry>;
+
+public:
+    explicit PathCache(std::size_t capacity, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_capacity{capacity}
+        , m_size{0}
+        , m_stats{0, 0}
+        , m_entries{resource}
+        , m_index{resource}
+    {}
+
+    std::size_t capacity() const { return m_capacity; }
+    Stats stats() const { return m_stats; }
+
+    /** Copies cached ids into result, false on a miss. */
+    bool find(Kind kind, uint64_t key, uint64_t epoch, std::vector<uint32_t>& result)
+    {
+        const auto it = m_index.find(Key{kind, key});
+        if (it == m_index.end())
+        {
+            ++m_stats.misses;
+            return false;
+        }
+        else if (it->second->epoch != epoch)
+        {
+            erase(it->second);
+            m_index.erase(it);
+            ++m_stats.misses;
+            return false;
+        }
+
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        result.assign(it->second->ids.begin(), it->second->ids.end());
+        ++m_stats.hits;
+        return true;
+    }
+
+    void insert(Kind kind, uint64_t key, uint64_t epoch, const std::vector<uint32_t>& ids)
+    {
+        const auto cost = ids.size() + 1;
+        if (cost > m_capacity)
+        {
+            return;
+        }
+
+        const auto it = m_index.find(Key{kind, key});
+        if (it != m_index.end())
+        {
+            erase(it->second);
+            m_index.erase(it);
+        }
+
+        while (m_size + cost > m_capacity)
+        {
+            m_index.erase(m_entries.back().key);
+            erase(std::prev(m_entries.end()));
+        }
+
+        m_entries.push_front(Entry{Key{kind, key},
+                                   epoch,
+                                   std::pmr::vector<uint32_t>{ids.begin(), ids.end(), m_entries.get_allocator().resource()}});
+        m_index.emplace(Key{kind, key}, m_entries.begin());
+        m_size += cost;
+    }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_index.clear();
+        m_size = 0;
+    }
+
+private:
+    void erase(Entries::iterator entry)
+    {
+        m_size -= entry->ids.size() + 1;
+        m_entries.erase(entry);
+    }
+
+private:
+    std::size_t m_capacity;
+    std::size_t m_size;
+    Stats m_stats;
+    Entries m_entries;
+    std::pmr::unordered_map<Key, Entries::iterator, KeyHash> m_index;
+};
+
+}  // namespace utils
+}  // namespace mesh
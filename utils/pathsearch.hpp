@@ -0,0 +1,267 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <inttypes.h>
+#include <limits>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "pairingheap.hpp"
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Reusable bidirectional breadth first search. Visited marks and parents are
+ * kept in arrays indexed by dense vertex index and stamped with the query
+ * number and frontier buffers are sized for the whole graph, so starting
+ * a new query does not clear or allocate anything until the graph grows.
+ * Graph is the same adapter as for ParallelBfs.
+ */
+class PathSearch
+{
+    static constexpr auto FORWARD = 0u;
+    static constexpr auto BACKWARD = 1u;
+
+public:
+    explicit PathSearch(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_stamp{0}
+        , m_stamps{std::pmr::vector<uint32_t>{resource}, std::pmr::vector<uint32_t>{resource}}
+        , m_parents{std::pmr::vector<uint32_t>{resource}, std::pmr::vector<uint32_t>{resource}}
+        , m_frontiers{std::pmr::vector<uint32_t>{resource}, std::pmr::vector<uint32_t>{resource}}
+        , m_nextFrontier{resource}
+        , m_distances{std::pmr::vector<double>{resource}, std::pmr::vector<double>{resource}}
+        , m_vertices{resource}
+        , m_potentials{resource}
+        , m_heaps{PairingHeap{resource}, PairingHeap{resource}}
+    {}
+
+    /** Fills path with the shortest path from begin to end, empty if there is none. */
+    template <typename Graph>
+    bool shortestPath(const Graph& graph, uint32_t begin, uint32_t end, std::vector<uint32_t>& path)
+    {
+        path.clear();
+        if (begin == end)
+        {
+            path.push_back(begin);
+            return true;
+        }
+
+        prepare(graph.indexBound());
+        mark(FORWARD, graph.index(begin), begin);
+        mark(BACKWARD, graph.index(end), end);
+        m_frontiers[FORWARD].push_back(begin);
+        m_frontiers[BACKWARD].push_back(end);
+
+        while (!m_frontiers[FORWARD].empty() && !m_frontiers[BACKWARD].empty())
+        {
+            const auto side = m_frontiers[FORWARD].size() <= m_frontiers[BACKWARD].size() ? FORWARD : BACKWARD;
+            const auto otherSide = 1 - side;
+
+            auto meeting = uint32_t{0};
+            auto met = false;
+            m_nextFrontier.clear();
+            for (const auto vertex : m_frontiers[side])
+            {
+                met = graph.forEachNeighbour(vertex, [&](uint32_t next)
+                {
+                    const auto nextIndex = graph.index(next);
+                    if (isMarked(side, nextIndex))
+                    {
+                        return false;
+                    }
+                    mark(side, nextIndex, vertex);
+                    m_nextFrontier.push_back(next);
+                    meeting = next;
+                    return isMarked(otherSide, nextIndex);
+                });
+
+                if (met)
+                {
+                    joinPath(graph, begin, end, meeting, path);
+                    return true;
+                }
+            }
+            std::swap(m_frontiers[side], m_nextFrontier);
+        }
+        return false;
+    }
+
+    /**
+     * Fills path with the cheapest path from begin to end. ForEachArc calls
+     * f(next, weight) for every arc leaving vertex, weights must not be
+     * negative. Potential returns p(v), the average (pf(v) - pb(v)) / 2 of
+     * lower bounds pf on the cost from v to end and pb on the cost from begin
+     * to v. The forward side keys vertices by distance + p and the backward
+     * side by distance - p, so the search stops once the two top keys sum to
+     * at least the best path found. That is only exact when p is feasible
+     * for both sides, which walk the same arcs: |p(u) - p(v)| <= weight for
+     * every arc u -> v. Zero gives plain bidirectional Dijkstra.
+     */
+    template <typename Graph, typename ForEachArc, typename Potential>
+    bool cheapestPath(const Graph& graph,
+                      uint32_t begin,
+                      uint32_t end,
+                      ForEachArc&& forEachArc,
+                      Potential&& potential,
+                      std::vector<uint32_t>& path)
+    {
+        path.clear();
+        if (begin == end)
+        {
+            path.push_back(begin);
+            return true;
+        }
+
+        const auto indexBound = graph.indexBound();
+        prepare(indexBound);
+        for (auto side : {FORWARD, BACKWARD})
+        {
+            m_distances[side].resize(std::max<std::size_t>(m_distances[side].size(), indexBound));
+            m_heaps[side].reset(indexBound);
+        }
+        m_vertices.resize(std::max<std::size_t>(m_vertices.size(), indexBound));
+        m_potentials.resize(std::max<std::size_t>(m_potentials.size(), indexBound));
+
+        const auto reach = [&](uint32_t side, uint32_t vertex, uint32_t parent, double distance)
+        {
+            const auto vertexIndex = graph.index(vertex);
+            if (!isMarked(side, vertexIndex))
+            {
+                if (!isMarked(1 - side, vertexIndex))
+                {
+                    m_vertices[vertexIndex] = vertex;
+                    m_potentials[vertexIndex] = potential(vertex);
+                }
+                mark(side, vertexIndex, parent);
+                m_distances[side][vertexIndex] = distance;
+                m_heaps[side].push(vertexIndex, key(side, vertexIndex));
+            }
+            else if (m_heaps[side].contains(vertexIndex) && distance < m_distances[side][vertexIndex])
+            {
+                m_parents[side][vertexIndex] = parent;
+                m_distances[side][vertexIndex] = distance;
+                m_heaps[side].decrease(vertexIndex, key(side, vertexIndex));
+            }
+        };
+
+        reach(FORWARD, begin, begin, 0.0);
+        reach(BACKWARD, end, end, 0.0);
+
+        auto best = std::numeric_limits<double>::infinity();
+        auto meeting = begin;
+        while (!m_heaps[FORWARD].empty() && !m_heaps[BACKWARD].empty())
+        {
+            if (m_heaps[FORWARD].topKey() + m_heaps[BACKWARD].topKey() >= best)
+            {
+                break;
+            }
+
+            const auto side = m_heaps[FORWARD].topKey() <= m_heaps[BACKWARD].topKey() ? FORWARD : BACKWARD;
+            const auto otherSide = 1 - side;
+            const auto vertex = m_vertices[m_heaps[side].pop()];
+            const auto distance = m_distances[side][graph.index(vertex)];
+
+            forEachArc(vertex, [&](uint32_t next, double weight)
+            {
+                reach(side, next, vertex, distance + weight);
+
+                const auto nextIndex = graph.index(next);
+                if (isMarked(otherSide, nextIndex))
+                {
+                    const auto total = m_distances[side][nextIndex] + m_distances[otherSide][nextIndex];
+                    if (total < best)
+                    {
+                        best = total;
+                        meeting = next;
+                    }
+                }
+            });
+        }
+
+        if (best == std::numeric_limits<double>::infinity())
+        {
+            return false;
+        }
+        joinPath(graph, begin, end, meeting, path);
+        return true;
+    }
+
+private:
+    double key(uint32_t side, uint32_t vertexIndex) const
+    {
+        const auto potential = m_potentials[vertexIndex];
+        return m_distances[side][vertexIndex] + (side == FORWARD ? potential : -potential);
+    }
+
+    void prepare(uint32_t indexBound)
+    {
+        for (auto side : {FORWARD, BACKWARD})
+        {
+            if (m_stamps[side].size() < indexBound)
+            {
+                m_stamps[side].resize(indexBound, 0);
+                m_parents[side].resize(indexBound, 0);
+                m_frontiers[side].reserve(indexBound);
+            }
+            m_frontiers[side].clear();
+        }
+        m_nextFrontier.reserve(indexBound);
+
+        if (++m_stamp == 0)
+        {
+            std::fill(m_stamps[FORWARD].begin(), m_stamps[FORWARD].end(), 0);
+            std::fill(m_stamps[BACKWARD].begin(), m_stamps[BACKWARD].end(), 0);
+            m_stamp = 1;
+        }
+    }
+
+    bool isMarked(uint32_t side, uint32_t vertexIndex) const
+    {
+        return m_stamps[side][vertexIndex] == m_stamp;
+    }
+
+    void mark(uint32_t side, uint32_t vertexIndex, uint32_t parent)
+    {
+        m_stamps[side][vertexIndex] = m_stamp;
+        m_parents[side][vertexIndex] = parent;
+    }
+
+    template <typename Graph>
+    void joinPath(const Graph& graph, uint32_t begin, uint32_t end, uint32_t meeting, std::vector<uint32_t>& path) const
+    {
+        for (auto vertex = meeting; vertex != begin; vertex = m_parents[FORWARD][graph.index(vertex)])
+        {
+            path.push_back(vertex);
+        }
+        path.push_back(begin);
+        std::reverse(path.begin(), path.end());
+
+        for (auto vertex = meeting; vertex != end;)
+        {
+            vertex = m_parents[BACKWARD][graph.index(vertex)];
+            path.push_back(vertex);
+        }
+    }
+
+private:
+    uint32_t m_stamp;
+    std::pmr::vector<uint32_t> m_stamps[2];
+    std::pmr::vector<uint32_t> m_parents[2];
+    std::pmr::vector<uint32_t> m_frontiers[2];
+    std::pmr::vector<uint32_t> m_nextFrontier;
+    std::pmr::vector<double> m_distances[2];
+    std::pmr::vector<uint32_t> m_vertices;
+    std::pmr::vector<double> m_potentials;
+    PairingHeap m_heaps[2];
+};
+
+}  // namespace utils
+}  // namespace mesh
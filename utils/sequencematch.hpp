@@ -0,0 +1,231 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <inttypes.h>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+#include "utils/execution.hpp"
+#include "utils/threadpool.hpp"
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Finds walks v0, v1, ..., vk-1 whose vertex at depth d satisfies the d-th
+ * predicate. Instead of trying every walk it keeps one layer of vertices per
+ * depth (dynamic programming over (vertex, depth)): layer d holds vertices
+ * matching predicate d with a neighbour in layer d - 1. Every predicate is
+ * called at most once per vertex. With a parallel policy layers bigger than
+ * GRAIN are split between the workers of the shared pool, predicates have to
+ * be safe to call concurrently then. Per-worker layers grow on worker threads
+ * and do not use given memory resource.
+ *
+ * Graph is the same adapter as for ParallelBfs.
+ */
+template <typename Graph>
+class SequenceMatch
+{
+    static constexpr std::size_t GRAIN = 1024;
+
+public:
+    explicit SequenceMatch(Graph graph, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_graph{std::move(graph)}
+        , m_resource{resource}
+        , m_words{(m_graph.indexBound() + 63) / 64}
+        , m_seen{m_words, resource}
+        , m_layers{}
+        , m_members{}
+        , m_vertices{resource}
+        , m_local{}
+    {}
+
+    /**
+     * Builds layers for depths below length, match(depth, vertex) is the
+     * predicate of given depth. Returns true if any walk matches all of them.
+     */
+    template <typename Policy, typename Match>
+    bool match(Policy policy, std::size_t length, Match&& match)
+    {
+        m_layers.clear();
+        m_members.clear();
+        if (length == 0)
+        {
+            return false;
+        }
+
+        m_vertices.clear();
+        m_graph.forEachVertex([this](uint32_t vertex) { m_vertices.push_back(vertex); });
+        nextLayer(policy, m_vertices, [&](uint32_t vertex, std::pmr::vector<uint32_t>& layer)
+        {
+            if (match(0, vertex))
+            {
+                layer.push_back(vertex);
+            }
+        });
+
+        for (auto depth = std::size_t{1}; depth < length && !m_layers.back().empty(); ++depth)
+        {
+            std::fill(m_seen.begin(), m_seen.end(), 0);
+            nextLayer(policy, m_layers.back(), [&](uint32_t vertex, std::pmr::vector<uint32_t>& layer)
+            {
+                m_graph.forEachNeighbour(vertex, [&](uint32_t next)
+                {
+                    if (claim(m_graph.index(next)) && match(depth, next))
+                    {
+                        layer.push_back(next);
+                    }
+                    return false;
+                });
+            });
+        }
+        return m_layers.size() == length && !m_layers.back().empty();
+    }
+
+    /** Last vertices of all matching walks, valid after match() returned true. */
+    const std::pmr::vector<uint32_t>& ends() const
+    {
+        return m_layers.back();
+    }
+
+    /**
+     * The walk a depth first search would find first: earliest start vertex
+     * and earliest neighbours in the graph's iteration order. Layers are
+     * pruned backwards to vertices which lead to a full match, so the walk
+     * is followed without backtracking.
+     */
+    void firstWalk(std::vector<uint32_t>& walk)
+    {
+        walk.clear();
+        if (m_layers.empty() || m_layers.back().empty())
+        {
+            return;
+        }
+
+        for (auto depth = m_layers.size() - 1; depth > 0; --depth)
+        {
+            for (const auto vertex : m_layers[depth - 1])
+            {
+                const auto leads = m_graph.forEachNeighbour(vertex, [&](uint32_t next)
+                {
+                    return isMember(depth, m_graph.index(next));
+                });
+                if (!leads)
+                {
+                    dropMember(depth - 1, m_graph.index(vertex));
+                }
+            }
+        }
+
+        for (const auto vertex : m_vertices)
+        {
+            if (isMember(0, m_graph.index(vertex)))
+            {
+                walk.push_back(vertex);
+                break;
+            }
+        }
+
+        for (auto depth = std::size_t{1}; depth < m_layers.size(); ++depth)
+        {
+            m_graph.forEachNeighbour(walk.back(), [&](uint32_t next)
+            {
+                if (isMember(depth, m_graph.index(next)))
+                {
+                    walk.push_back(next);
+                    return true;
+                }
+                return false;
+            });
+        }
+    }
+
+private:
+    /** Runs step(vertex, layer) on every vertex of given list, in parallel for big lists and parallel policies. */
+    template <typename Policy, typename Step>
+    void nextLayer(Policy, const std::pmr::vector<uint32_t>& vertices, Step&& step)
+    {
+        auto parts = std::size_t{1};
+        if constexpr (!std::is_same_v<std::decay_t<Policy>, execution::SequencedPolicy>)
+        {
+            parts = std::clamp<std::size_t>((vertices.size() + GRAIN - 1) / GRAIN, 1, sharedPool().size());
+        }
+        while (m_local.size() < parts)
+        {
+            m_local.emplace_back(std::pmr::new_delete_resource());
+        }
+        for (auto& local : m_local)
+        {
+            local.clear();
+        }
+
+        forEachPart(parts, vertices.size(), [&](std::size_t part, std::size_t first, std::size_t last)
+        {
+            for (auto i = first; i < last; ++i)
+            {
+                step(vertices[i], m_local[part]);
+            }
+        });
+
+        auto layer = std::pmr::vector<uint32_t>{m_resource};
+        auto members = std::pmr::vector<uint64_t>(m_words, 0, m_resource);
+        for (const auto& local : m_local)
+        {
+            layer.insert(layer.end(), local.begin(), local.end());
+        }
+        for (const auto vertex : layer)
+        {
+            const auto vertexIndex = m_graph.index(vertex);
+            members[vertexIndex / 64] |= bit(vertexIndex);
+        }
+        m_layers.push_back(std::move(layer));
+        m_members.push_back(std::move(members));
+    }
+
+    bool claim(uint32_t vertexIndex)
+    {
+        auto& word = m_seen[vertexIndex / 64];
+        const auto mask = bit(vertexIndex);
+        if (word.load(std::memory_order_relaxed) & mask)
+        {
+            return false;
+        }
+        return (word.fetch_or(mask, std::memory_order_relaxed) & mask) == 0;
+    }
+
+    bool isMember(std::size_t depth, uint32_t vertexIndex) const
+    {
+        return (m_members[depth][vertexIndex / 64] & bit(vertexIndex)) != 0;
+    }
+
+    void dropMember(std::size_t depth, uint32_t vertexIndex)
+    {
+        m_members[depth][vertexIndex / 64] &= ~bit(vertexIndex);
+    }
+
+    static uint64_t bit(uint32_t vertexIndex)
+    {
+        return uint64_t{1} << (vertexIndex % 64);
+    }
+
+private:
+    Graph m_graph;
+    std::pmr::memory_resource* m_resource;
+    std::size_t m_words;
+    std::pmr::vector<std::atomic<uint64_t>> m_seen;
+    std::vector<std::pmr::vector<uint32_t>> m_layers;
+    std::vector<std::pmr::vector<uint64_t>> m_members;
+    std::pmr::vector<uint32_t> m_vertices;
+    std::vector<std::pmr::vector<uint32_t>> m_local;
+};
+
+}  // namespace utils
+}  // namespace mesh
@@ -0,0 +1,188 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <inttypes.h>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Tokenizer of the MeshPack text format. Reads either text already in
+ * memory or a stream, which is consumed in CHUNK sized pieces, so memory
+ * stays bounded by the chunk and the longest description. Tokens are
+ * separated by any of " \t\n;", descriptions are quoted and end with a quote
+ * followed by a new line (or the end of data), so they may contain both.
+ */
+class TextReader
+{
+public:
+    static constexpr std::size_t CHUNK = std::size_t{1} << 16;
+
+public:
+    explicit TextReader(std::string_view data)
+        : m_input{nullptr}
+        , m_buffer{}
+        , m_data{data}
+        , m_cursor{0}
+        , m_consumed{0}
+    {}
+
+    explicit TextReader(std::istream& input)
+        : m_input{&input}
+        , m_buffer(CHUNK, '\0')
+        , m_data{}
+        , m_cursor{0}
+        , m_consumed{0}
+    {}
+
+    /** Byte offset of the next unread character. */
+    uint64_t offset() const { return m_consumed + m_cursor; }
+
+    /** Byte offset of the next token. */
+    uint64_t tokenOffset()
+    {
+        skipSeparators();
+        return offset();
+    }
+
+    std::optional<uint64_t> number()
+    {
+        skipSeparators();
+        auto length = std::size_t{0};
+        for (;;)
+        {
+            while (m_cursor + length < m_data.size() && isDigit(m_data[m_cursor + length]))
+            {
+                ++length;
+            }
+            if (m_cursor + length < m_data.size() || !fill())
+            {
+                break;
+            }
+        }
+
+        auto result = uint64_t{};
+        const auto first = m_data.data() + m_cursor;
+        const auto [last, error] = std::from_chars(first, first + length, result);
+        if (length == 0 || error != std::errc{})
+        {
+            return {};
+        }
+        m_cursor += static_cast<std::size_t>(last - first);
+        return result;
+    }
+
+    /** Description without quotes, valid until the next call. */
+    std::optional<std::string_view> quoted()
+    {
+        skipSeparators();
+        if (!available() || m_data[m_cursor] != '"')
+        {
+            return {};
+        }
+
+        auto length = std::size_t{1};
+        for (;;)
+        {
+            const auto rest = m_data.size() - m_cursor - length;
+            const auto* quote = static_cast<const char*>(std::memchr(m_data.data() + m_cursor + length, '"', rest));
+            if (!quote)
+            {
+                length += rest;
+                if (!fill())
+                {
+                    return {};
+                }
+                continue;
+            }
+
+            auto end = static_cast<std::size_t>(quote - m_data.data());
+            if (end + 1 == m_data.size())
+            {
+                length = end - m_cursor;
+                if (fill())
+                {
+                    continue;
+                }
+                end = m_cursor + length;
+            }
+            if (end + 1 < m_data.size() && m_data[end + 1] != '\n')
+            {
+                length = end + 1 - m_cursor;
+                continue;
+            }
+
+            const auto result = m_data.substr(m_cursor + 1, end - m_cursor - 1);
+            m_cursor = end + 1;
+            return result;
+        }
+    }
+
+private:
+    static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+    static bool isSeparator(char c) { return c == '\n' || c == '\t' || c == ' ' || c == ';'; }
+
+    bool available()
+    {
+        return m_cursor < m_data.size() || fill();
+    }
+
+    void skipSeparators()
+    {
+        while (available() && isSeparator(m_data[m_cursor]))
+        {
+            ++m_cursor;
+        }
+    }
+
+    /**
+     * Moves unread bytes to the front of the buffer and reads the next chunk
+     * after them, the buffer grows only when a single token fills it. Offsets
+     * relative to the cursor stay valid, false at the end of input.
+     */
+    bool fill()
+    {
+        if (!m_input || !*m_input)
+        {
+            return false;
+        }
+
+        const auto unread = m_data.size() - m_cursor;
+        if (unread != 0)
+        {
+            std::memmove(m_buffer.data(), m_data.data() + m_cursor, unread);
+        }
+        m_consumed += m_cursor;
+        m_cursor = 0;
+        if (unread == m_buffer.size())
+        {
+            m_buffer.resize(m_buffer.size() * 2);
+        }
+
+        m_input->read(m_buffer.data() + unread, static_cast<std::streamsize>(m_buffer.size() - unread));
+        const auto count = static_cast<std::size_t>(m_input->gcount());
+        m_data = std::string_view{m_buffer.data(), unread + count};
+        return count != 0;
+    }
+
+private:
+    std::istream* m_input;
+    std::string m_buffer;
+    std::string_view m_data;
+    std::size_t m_cursor;
+    uint64_t m_consumed;
+};
+
+}  // namespace utils
+}  // namespace mesh
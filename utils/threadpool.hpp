@@ -0,0 +1,180 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <inttypes.h>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Fixed set of worker threads running parallel regions. run(job) calls
+ * job(worker) once on every worker, the calling thread being worker 0, and
+ * returns when all of them are done. The first exception thrown by a job is
+ * rethrown from run(). One region runs at a time, tryRun() refuses to start
+ * another one instead of waiting (or deadlocking when called from a job).
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency())
+        : m_busy{false}
+        , m_lock{}
+        , m_wake{}
+        , m_done{}
+        , m_job{}
+        , m_generation{0}
+        , m_pending{0}
+        , m_stop{false}
+        , m_error{}
+        , m_threads{}
+    {
+        const auto workers = std::max(threads, 1u);
+        m_threads.reserve(workers - 1);
+        for (auto worker = 1u; worker < workers; ++worker)
+        {
+            m_threads.emplace_back([this, worker]() { work(worker); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            auto lock = std::lock_guard<std::mutex>{m_lock};
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    unsigned size() const
+    {
+        return static_cast<unsigned>(m_threads.size() + 1);
+    }
+
+    void run(std::function<void(unsigned)> job)
+    {
+        {
+            auto lock = std::lock_guard<std::mutex>{m_lock};
+            m_job = std::move(job);
+            m_pending = static_cast<unsigned>(m_threads.size());
+            m_error = nullptr;
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        execute(0);
+
+        auto lock = std::unique_lock<std::mutex>{m_lock};
+        m_done.wait(lock, [this]() { return m_pending == 0; });
+        m_job = nullptr;
+        if (m_error)
+        {
+            std::rethrow_exception(std::exchange(m_error, nullptr));
+        }
+    }
+
+    /** Runs job as run() does, false without running it when a region is in progress. */
+    bool tryRun(std::function<void(unsigned)> job)
+    {
+        if (m_busy.exchange(true, std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        try
+        {
+            run(std::move(job));
+        }
+        catch (...)
+        {
+            m_busy.store(false, std::memory_order_release);
+            throw;
+        }
+        m_busy.store(false, std::memory_order_release);
+        return true;
+    }
+
+private:
+    void work(unsigned worker)
+    {
+        auto seenGeneration = uint64_t{0};
+        while (true)
+        {
+            {
+                auto lock = std::unique_lock<std::mutex>{m_lock};
+                m_wake.wait(lock, [&]() { return m_stop || m_generation != seenGeneration; });
+                if (m_stop)
+                {
+                    return;
+                }
+                seenGeneration = m_generation;
+            }
+
+            execute(worker);
+
+            auto lock = std::lock_guard<std::mutex>{m_lock};
+            if (--m_pending == 0)
+            {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    void execute(unsigned worker)
+    {
+        try
+        {
+            m_job(worker);
+        }
+        catch (...)
+        {
+            auto lock = std::lock_guard<std::mutex>{m_lock};
+            if (!m_error)
+            {
+                m_error = std::current_exception();
+            }
+        }
+    }
+
+private:
+    std::atomic<bool> m_busy;
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    std::function<void(unsigned)> m_job;
+    uint64_t m_generation;
+    unsigned m_pending;
+    bool m_stop;
+    std::exception_ptr m_error;
+    std::vector<std::thread> m_threads;
+};
+
+/** Pool of one worker per hardware thread shared by parallel scans, started on first use. */
+inline ThreadPool& sharedPool()
+{
+    static auto pool = ThreadPool{};
+    return pool;
+}
+
+}  // namespace utils
+}  // namespace mesh
@@ -0,0 +1,278 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <cstddef>
+#include <inttypes.h>
+#include <iterator>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+#include "objects/types.hpp"
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Lazy breadth or depth first traversal from one node. Nodes are produced
+ * while iterating and neighbours of a node are looked at only when the loop
+ * moves past it, so breaking out early skips the rest of the mesh. Depth
+ * first order is the order of a recursive search. The mesh must not change
+ * while traversing.
+ */
+template <typename NodeDescription, typename EdgeDescription, typename Storage>
+class Traversal
+{
+    using NodeMap = objects::types::U32NodeMap<NodeDescription, Storage>;
+    using EdgeMap = objects::types::U32EdgeMap<EdgeDescription, Storage>;
+    using Node = objects::Node<NodeDescription>;
+    using Edge = objects::Edge<EdgeDescription>;
+
+    struct Frame
+    {
+        uint32_t nodeId;
+        uint32_t depth;
+        uint32_t position;
+    };
+
+public:
+    enum class Order
+    {
+        BREADTH_FIRST,
+        DEPTH_FIRST
+    };
+
+    struct Visit
+    {
+        uint32_t id;
+        const Node& node;
+        uint32_t depth;
+    };
+
+    struct EdgeVisit
+    {
+        uint32_t id;
+        const Edge& edge;
+    };
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Visit;
+        using reference = Visit;
+        using pointer = void;
+
+    public:
+        explicit iterator(Traversal* traversal = nullptr)
+            : m_traversal{traversal}
+        {}
+
+        Visit operator*() const { return m_traversal->visit(); }
+
+        iterator& operator++()
+        {
+            if (!m_traversal->advance())
+            {
+                m_traversal = nullptr;
+            }
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return m_traversal == other.m_traversal; }
+        bool operator!=(const iterator& other) const { return m_traversal != other.m_traversal; }
+
+    private:
+        Traversal* m_traversal;
+    };
+
+    /** Neighbours of one node (depth 1) or its edges, in edge ID order. */
+    template <bool Nodes>
+    class Incident
+    {
+    public:
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+            using value_type = std::conditional_t<Nodes, Visit, EdgeVisit>;
+            using reference = value_type;
+            using pointer = void;
+
+        public:
+            iterator(const Incident* incident, const uint32_t* edgeId)
+                : m_incident{incident}
+                , m_edgeId{edgeId}
+            {}
+
+            value_type operator*() const { return m_incident->at(*m_edgeId); }
+            iterator& operator++() { ++m_edgeId; return *this; }
+            bool operator==(const iterator& other) const { return m_edgeId == other.m_edgeId; }
+            bool operator!=(const iterator& other) const { return m_edgeId != other.m_edgeId; }
+
+        private:
+            const Incident* m_incident;
+            const uint32_t* m_edgeId;
+        };
+
+    public:
+        Incident(const NodeMap& nodes, const EdgeMap& edges, uint32_t nodeId)
+            : m_nodes{nodes}
+            , m_edges{edges}
+            , m_nodeId{nodeId}
+            , m_first{nullptr}
+            , m_last{nullptr}
+        {
+            const auto nodeIt = nodes.find(nodeId);
+            if (nodeIt != nodes.end())
+            {
+                m_first = nodeIt->second.edges().begin();
+                m_last = nodeIt->second.edges().end();
+            }
+        }
+
+        iterator begin() const { return iterator{this, m_first}; }
+        iterator end() const { return iterator{this, m_last}; }
+        std::size_t size() const { return static_cast<std::size_t>(m_last - m_first); }
+        bool empty() const { return m_first == m_last; }
+
+    private:
+        auto at(uint32_t edgeId) const
+        {
+            const auto& edge = m_edges.find(edgeId)->second;
+            if constexpr (Nodes)
+            {
+                const auto& endpoints = edge.nodes();
+                const auto nextNodeId = endpoints.first == m_nodeId ? endpoints.second : endpoints.first;
+                return Visit{nextNodeId, m_nodes.find(nextNodeId)->second, 1};
+            }
+            else
+            {
+                return EdgeVisit{edgeId, edge};
+            }
+        }
+
+    private:
+        const NodeMap& m_nodes;
+        const EdgeMap& m_edges;
+        uint32_t m_nodeId;
+        const uint32_t* m_first;
+        const uint32_t* m_last;
+    };
+
+    using Neighbours = Incident<true>;
+    using Edges = Incident<false>;
+
+public:
+    Traversal(const NodeMap& nodes,
+              const EdgeMap& edges,
+              uint32_t nodeId,
+              Order order,
+              std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_nodes{nodes}
+        , m_edges{edges}
+        , m_order{order}
+        , m_frames{resource}
+        , m_head{0}
+        , m_current{}
+        , m_visited{resource}
+    {
+        restart(nodeId);
+    }
+
+    Traversal(Traversal&&) = default;
+
+    /** Starts over from given node, keeping allocated buffers. */
+    void restart(uint32_t nodeId)
+    {
+        m_frames.clear();
+        m_visited.clear();
+        m_head = 0;
+        if (m_nodes.find(nodeId) != m_nodes.end())
+        {
+            m_visited.insert(nodeId);
+            m_frames.push_back(Frame{nodeId, 0, 0});
+            m_current = m_frames.front();
+        }
+    }
+
+    iterator begin() { return iterator{m_frames.empty() ? nullptr : this}; }
+    iterator end() { return iterator{}; }
+
+private:
+    Visit visit() const
+    {
+        return Visit{m_current.nodeId, m_nodes.find(m_current.nodeId)->second, m_current.depth};
+    }
+
+    bool advance()
+    {
+        return m_order == Order::BREADTH_FIRST ? advanceBreadthFirst() : advanceDepthFirst();
+    }
+
+    bool advanceBreadthFirst()
+    {
+        const auto current = m_frames[m_head++];
+        for (const auto edgeId : m_nodes.find(current.nodeId)->second.edges())
+        {
+            const auto nextNodeId = otherEndpoint(edgeId, current.nodeId);
+            if (m_visited.insert(nextNodeId).second)
+            {
+                m_frames.push_back(Frame{nextNodeId, current.depth + 1, 0});
+            }
+        }
+
+        if (m_head == m_frames.size())
+        {
+            return false;
+        }
+        m_current = m_frames[m_head];
+        return true;
+    }
+
+    bool advanceDepthFirst()
+    {
+        while (!m_frames.empty())
+        {
+            auto& top = m_frames.back();
+            const auto& edgeIds = m_nodes.find(top.nodeId)->second.edges();
+            while (top.position < edgeIds.size())
+            {
+                const auto nextNodeId = otherEndpoint(edgeIds.begin()[top.position++], top.nodeId);
+                if (m_visited.insert(nextNodeId).second)
+                {
+                    m_current = Frame{nextNodeId, top.depth + 1, 0};
+                    m_frames.push_back(m_current);
+                    return true;
+                }
+            }
+            m_frames.pop_back();
+        }
+        return false;
+    }
+
+    uint32_t otherEndpoint(uint32_t edgeId, uint32_t nodeId) const
+    {
+        const auto& endpoints = m_edges.find(edgeId)->second.nodes();
+        return endpoints.first == nodeId ? endpoints.second : endpoints.first;
+    }
+
+private:
+    const NodeMap& m_nodes;
+    const EdgeMap& m_edges;
+    Order m_order;
+    std::pmr::vector<Frame> m_frames;
+    std::size_t m_head;
+    Frame m_current;
+    objects::types::U32Set m_visited;
+};
+
+}  // namespace utils
+}  // namespace mesh
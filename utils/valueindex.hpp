@@ -0,0 +1,119 @@
+/**
+ * Created by Karol Dudzic @ 2022
+ */
+#pragma once
+
+#include <functional>
+#include <inttypes.h>
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+
+namespace mesh
+{
+namespace utils
+{
+
+/**
+ * Node IDs grouped by node description. Mesh keeps it behind this interface,
+ * so descriptions have to be hashable only when the index is enabled.
+ */
+template <typename Description>
+class IValueIndex
+{
+public:
+    using Ids = std::pmr::vector<uint32_t>;
+
+public:
+    virtual ~IValueIndex() = default;
+
+    virtual void insert(uint32_t nodeId, const Description& description) = 0;
+    virtual void erase(uint32_t nodeId, const Description& description) = 0;
+    virtual void clear() = 0;
+
+    /** IDs of nodes with given description, nullptr if there are none. */
+    virtual const Ids* find(const Description& description) const = 0;
+
+    /** Empty index of the same type. */
+    virtual std::unique_ptr<IValueIndex> fresh(std::pmr::memory_resource* resource) const = 0;
+};
+
+/**
+ * Keeps position of every node ID within its group, so erasing moves the
+ * last ID of the group into the hole instead of searching for it.
+ */
+template <typename Description,
+          typename Hash = std::hash<Description>,
+          typename Equal = std::equal_to<Description>>
+class ValueIndex : public IValueIndex<Description>
+{
+    using Ids = typename IValueIndex<Description>::Ids;
+
+public:
+    explicit ValueIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_ids{resource}
+        , m_positions{resource}
+    {}
+
+    void insert(uint32_t nodeId, const Description& description) override
+    {
+        auto& ids = m_ids[description];
+        m_positions[nodeId] = static_cast<uint32_t>(ids.size());
+        ids.push_back(nodeId);
+    }
+
+    void erase(uint32_t nodeId, const Description& description) override
+    {
+        const auto it = m_ids.find(description);
+        if (it == m_ids.end())
+        {
+            return;
+        }
+
+        auto& ids = it->second;
+        const auto positionIt = m_positions.find(nodeId);
+        if (positionIt == m_positions.end() || positionIt->second >= ids.size() || ids[positionIt->second] != nodeId)
+        {
+            return;
+        }
+
+        const auto position = positionIt->second;
+        m_positions.erase(positionIt);
+        if (position + 1 < ids.size())
+        {
+            ids[position] = ids.back();
+            m_positions[ids[position]] = position;
+        }
+        ids.pop_back();
+        if (ids.empty())
+        {
+            m_ids.erase(it);
+        }
+    }
+
+    void clear() override
+    {
+        m_ids.clear();
+        m_positions.clear();
+    }
+
+    const Ids* find(const Description& description) const override
+    {
+        const auto it = m_ids.find(description);
+        return it != m_ids.end() ? &it->second : nullptr;
+    }
+
+    std::unique_ptr<IValueIndex<Description>> fresh(std::pmr::memory_resource* resource) const override
+    {
+        return std::make_unique<ValueIndex>(resource);
+    }
+
+private:
+    std::pmr::unordered_map<Description, Ids, Hash, Equal> m_ids;
+    std::pmr::unordered_map<uint32_t, uint32_t> m_positions;
+};
+
+}  // namespace utils
+}  // namespace mesh